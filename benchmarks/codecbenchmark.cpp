@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+// Throughput of the UTF-8 detection: SimdText::validateUtf8 against the
+// Qt UTF-8 decoder counting the invalid characters, over generated text.
+//
+// usage: codecbenchmark [megabytes]    (256 by default)
+
+
+#include "simdtext.h"
+#include "textcodec.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <QTextCodec>
+#include <QTextStream>
+
+#include <cstdlib>
+
+
+// best of the runs, to skip page faults and frequency scaling
+static const int Runs = 5;
+
+
+static QByteArray repeated(const QByteArray& line, qint64 size)
+{
+    QByteArray bytes;
+    bytes.reserve(int(size));
+    while (bytes.size() + line.size() <= size) {
+        bytes += line;
+    }
+    return bytes;
+}
+
+
+template <typename Scan>
+static double gigabytesPerSecond(const QByteArray& bytes, Scan scan)
+{
+    qint64 best = -1;
+    for (int run = 0; run < Runs; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        scan();
+        const qint64 ns = timer.nsecsElapsed();
+        if (best < 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best > 0 ? double(bytes.size()) / best : 0.;
+}
+
+
+static void measure(QTextStream& out, const char* name, const QByteArray& bytes)
+{
+    volatile int sink = 0;
+
+    const double simd = gigabytesPerSecond(bytes, [&]() {
+        sink = sink + SimdText::validateUtf8(bytes.constData(), bytes.size());
+    });
+
+    QTextCodec* utf8 = QTextCodec::codecForName("UTF-8");
+    const double qt = gigabytesPerSecond(bytes, [&]() {
+        QTextCodec::ConverterState state;
+        const QString text = utf8->toUnicode(bytes.constData(), bytes.size(), &state);
+        sink = sink + state.invalidChars;
+    });
+
+    const QByteArray detected = TextCodec::codecForByteArray(bytes, false)->name();
+
+    out << name << ": " << bytes.size() / (1024 * 1024) << " MB, detected as " << QString::fromLatin1(detected) << Qt::endl;
+    out << "    SimdText::validateUtf8  " << QString::number(simd, 'f', 2) << " GB/s" << Qt::endl;
+    out << "    QTextCodec::toUnicode   " << QString::number(qt, 'f', 2) << " GB/s" << Qt::endl;
+}
+
+
+int main(int argc, char *argv[])
+{
+    const qint64 size = qint64(argc > 1 ? std::atoi(argv[1]) : 256) * 1024 * 1024;
+
+    QTextStream out(stdout);
+
+    measure(out, "ASCII", repeated("The quick brown fox jumps over the lazy dog, again and again.\n", size));
+    measure(out, "mostly ASCII UTF-8", repeated("Perché la volpe è così veloce? Perché è già là, sempre.\n", size));
+    measure(out, "CJK UTF-8", repeated("\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE\xE6\x96\x87\xE7\xAB\xA0\xE3\x81\xA7\xE3\x81\x99\xE3\x80\x82\n", size));
+    measure(out, "Latin-1", repeated("Perch\xE8 la volpe \xE8 cos\xEC veloce? Perch\xE8 \xE8 gi\xE0 l\xE0, sempre.\n", size));
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+// Find over a big document: SearchEngine over a plain text snapshot
+// against QTextDocument::find, for a few patterns matching near the end.
+//
+// usage: searchbenchmark [megabytes]    (100 by default)
+// (-platform offscreen runs it without a display)
+
+
+#include "searchengine.h"
+
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QString>
+#include <QStringList>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextStream>
+
+#include <cstdlib>
+
+
+static QString generatedText(qint64 size, const QString& last)
+{
+    const QString line = QStringLiteral("Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor.\n");
+
+    QString text;
+    text.reserve(int(size));
+    while (text.size() + line.size() + last.size() < size) {
+        text += line;
+    }
+    text += last;
+    return text;
+}
+
+
+static void measure(QTextStream& out, const QString& text, QTextDocument& document,
+                    const QString& pattern, Qt::CaseSensitivity cs)
+{
+    SearchEngine engine;
+    engine.setPattern(pattern, cs);
+
+    QElapsedTimer timer;
+    timer.start();
+    const qint64 position = engine.indexIn(text.utf16(), text.size(), 0);
+    const qint64 engineMs = timer.elapsed();
+
+    const QTextDocument::FindFlags flags = (cs == Qt::CaseSensitive) ? QTextDocument::FindCaseSensitively
+                                                                      : QTextDocument::FindFlags();
+    timer.restart();
+    const QTextCursor found = document.find(pattern, 0, flags);
+    const qint64 documentMs = timer.elapsed();
+
+    out << "\"" << pattern << "\" " << (cs == Qt::CaseSensitive ? "case sensitive" : "case insensitive")
+        << ", found at " << position << " / " << (found.isNull() ? -1 : found.selectionStart()) << Qt::endl;
+    out << "    SearchEngine::indexIn   " << engineMs << " ms" << Qt::endl;
+    out << "    QTextDocument::find     " << documentMs << " ms" << Qt::endl;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    const QStringList args = app.arguments();
+    const qint64 size = qint64(args.size() > 1 ? args.at(1).toInt() : 100) * 1024 * 1024;
+
+    QTextStream out(stdout);
+
+    const QString text = generatedText(size, QStringLiteral("The needle is here, at the end of the haystack.\n"));
+
+    QElapsedTimer timer;
+    timer.start();
+    QTextDocument document;
+    document.setPlainText(text);
+    out << text.size() / (1024 * 1024) << " M characters, loaded in " << timer.elapsed() << " ms" << Qt::endl;
+
+    timer.restart();
+    const QString snapshot = document.toPlainText();
+    out << "    snapshot (toPlainText)  " << timer.elapsed() << " ms, " << snapshot.size() << " characters" << Qt::endl;
+
+    measure(out, snapshot, document, QStringLiteral("needle"), Qt::CaseSensitive);
+    measure(out, snapshot, document, QStringLiteral("NEEDLE"), Qt::CaseInsensitive);
+    measure(out, snapshot, document, QStringLiteral("at the end of the haystack"), Qt::CaseSensitive);
+    measure(out, snapshot, document, QStringLiteral("x"), Qt::CaseSensitive);
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+// Startup cost of the syntax highlighting: loading the definitions
+// (new KSyntaxHighlighting::Repository) against setting up an editor
+// with a shared, already loaded repository, and the startup as the
+// application does it, loading the repository in a thread meanwhile.
+//
+// usage: startupbenchmark [file name]    (main.cpp by default)
+// (-platform offscreen runs it without a display)
+
+
+#include <KSyntaxHighlighting/Definition>
+#include <KSyntaxHighlighting/Repository>
+#include <KSyntaxHighlighting/SyntaxHighlighter>
+#include <KSyntaxHighlighting/Theme>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QPlainTextEdit>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+
+
+// best of the runs, the first ones read the definitions from the disk
+static const int Runs = 5;
+
+
+template <typename Step>
+static qint64 bestMs(Step step)
+{
+    qint64 best = -1;
+    for (int run = 0; run < Runs; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        step();
+        const qint64 ms = timer.elapsed();
+        if (best < 0 || ms < best) {
+            best = ms;
+        }
+    }
+    return best;
+}
+
+
+// what a new window does with the repository: an editor highlighting
+// a file with the definition found for its name
+static void createEditor(KSyntaxHighlighting::Repository* repository, const QString& fileName)
+{
+    QPlainTextEdit editor;
+    editor.setPlainText(QStringLiteral("int main()\n{\n    return 0;\n}\n"));
+
+    KSyntaxHighlighting::SyntaxHighlighter highlighter(editor.document());
+    highlighter.setTheme(repository->themeForPalette(editor.palette()));
+    highlighter.setDefinition(repository->definitionForFileName(fileName));
+}
+
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    const QStringList args = app.arguments();
+    const QString fileName = args.size() > 1 ? args.at(1) : QStringLiteral("main.cpp");
+
+    QTextStream out(stdout);
+
+    QElapsedTimer timer;
+    timer.start();
+    KSyntaxHighlighting::Repository* repository = new KSyntaxHighlighting::Repository;
+    out << repository->definitions().size() << " definitions" << Qt::endl;
+    out << "    new Repository, first       " << timer.elapsed() << " ms" << Qt::endl;
+
+    out << "    new Repository              " << bestMs([]() {
+        delete new KSyntaxHighlighting::Repository;
+    }) << " ms" << Qt::endl;
+
+    out << "    editor, shared repository   " << bestMs([&]() {
+        createEditor(repository, fileName);
+    }) << " ms" << Qt::endl;
+
+    delete repository;
+
+    // the application: the first window is created while the definitions
+    // get loaded, then it waits for them
+    out << "    editor, loading thread      " << bestMs([&]() {
+        KSyntaxHighlighting::Repository* loaded = nullptr;
+        QThread* thread = QThread::create([&loaded]() {
+            loaded = new KSyntaxHighlighting::Repository;
+        });
+        thread->start();
+
+        QPlainTextEdit window;
+        window.setPlainText(QStringLiteral("int main()\n{\n    return 0;\n}\n"));
+
+        thread->wait();
+        delete thread;
+        createEditor(loaded, fileName);
+        delete loaded;
+    }) << " ms" << Qt::endl;
+
+    return 0;
+}
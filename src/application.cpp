@@ -10,25 +10,89 @@
 #include "application.h"
 #include "mainwindow.h"
 #include "cutepadadaptor.h"
+#include "editjournal.h"
+#include "findallwindow.h"
+#include "syntaxresolver.h"
+
+#include <KSyntaxHighlighting/Repository>
+#include <ksyntaxhighlighting_version.h>
 
 #include <QCommandLineParser>
 
 #include <QDBusConnection>
 #include <QDBusAbstractAdaptor>
+#include <QFile>
 #include <QFileInfo>
 #include <QFileSystemWatcher>
+#include <QMessageBox>
 #include <QStringList>
+#include <QThread>
 
 #include <QDebug>
 
 
+// the repository is a QObject since KF 5.94: once its loading thread is
+// gone it belongs to no thread, the GUI one takes it (the one exception
+// to QObject::moveToThread() being called from the object thread)
+static void moveRepositoryToGuiThread(KSyntaxHighlighting::Repository* repository)
+{
+#if KSYNTAXHIGHLIGHTING_VERSION >= QT_VERSION_CHECK(5, 94, 0)
+    repository->moveToThread(QThread::currentThread());
+#else
+    Q_UNUSED(repository)
+#endif
+}
+
+
 Application::Application(int &argc, char *argv[])
     : QApplication(argc,argv)
     , _watcher(new QFileSystemWatcher(this))
+    , _findAllWindow(nullptr)
+    , _repositoryThread(nullptr)
+    , _repository(nullptr)
+    , _syntaxResolver(nullptr)
 {
     new CutepadAdaptor(this);
 
     connect(_watcher, &QFileSystemWatcher::fileChanged, this, &Application::notifyFileChanged);
+
+    // parsing all the syntax definitions takes a while: meanwhile
+    // the first window gets created and its file loaded
+    _repositoryThread = QThread::create([this]() {
+        _repository = new KSyntaxHighlighting::Repository;
+    });
+    _repositoryThread->start();
+}
+
+
+Application::~Application()
+{
+    delete _findAllWindow;
+
+    delete _syntaxResolver;
+    highlightingRepository();
+    delete _repository;
+}
+
+
+KSyntaxHighlighting::Repository* Application::highlightingRepository()
+{
+    if (_repositoryThread) {
+        _repositoryThread->wait();
+        delete _repositoryThread;
+        _repositoryThread = nullptr;
+        moveRepositoryToGuiThread(_repository);
+    }
+    return _repository;
+}
+
+
+SyntaxResolver* Application::syntaxResolver()
+{
+    if (!_syntaxResolver) {
+        _syntaxResolver = new SyntaxResolver(highlightingRepository());
+    }
+    return _syntaxResolver;
 }
 
 
@@ -54,10 +118,49 @@ void Application::parseCommandlineArgs()
     parser.process(*this);
 
     const QStringList posArgs = parser.positionalArguments();
+
+    // no need of an empty window, after a recovery
+    if (recoverJournals() && posArgs.isEmpty()) {
+        return;
+    }
     loadPaths(posArgs);
 }
 
 
+bool Application::recoverJournals()
+{
+    bool recovered = false;
+
+    const QStringList journals = EditJournal::orphans();
+    for (const QString &journal : journals) {
+        QString basePath;
+        if (!EditJournal::readBase(journal, &basePath)) {
+            // its edits cannot be replayed anymore
+            QFile::remove(journal);
+            continue;
+        }
+
+        const QString name = basePath.isEmpty() ? tr("untitled") : basePath;
+        int risp = QMessageBox::question(nullptr,
+                                         tr("Recover Unsaved Changes"),
+                                         tr("cutepad has not been closed properly.\nDo you want to recover the unsaved changes of %1?").arg(name),
+                                         QMessageBox::Yes | QMessageBox::No);
+
+        if (risp != QMessageBox::Yes) {
+            QFile::remove(journal);
+            continue;
+        }
+
+        MainWindow *mainWin = new MainWindow;
+        _windows.append(mainWin);
+        mainWin->show();
+        mainWin->recoverJournal(journal);
+        recovered = true;
+    }
+    return recovered;
+}
+
+
 void Application::loadPaths(const QStringList& paths)
 {
     if (paths.isEmpty()) {
@@ -95,6 +198,55 @@ void Application::loadPath(const QString& path)
 }
 
 
+void Application::gotoLine(const QString& path, int line)
+{
+    // no path: the active window
+    MainWindow* window = qobject_cast<MainWindow*>(activeWindow());
+    if (path.isEmpty()) {
+        if (!window && !_windows.isEmpty()) {
+            window = _windows.last();
+        }
+        if (window) {
+            window->gotoLine(line);
+        }
+        return;
+    }
+
+    loadPath(path);
+
+    // the window of path, the just created one otherwise
+    window = _windows.isEmpty() ? nullptr : _windows.last();
+    for (MainWindow* win : qAsConst(_windows)) {
+        if (win->filePath() == path) {
+            window = win;
+            break;
+        }
+    }
+
+    if (window) {
+        window->gotoLine(line);
+    }
+}
+
+
+void Application::showFindAllWindow(const QString& text)
+{
+    if (!_findAllWindow) {
+        _findAllWindow = new FindAllWindow;
+        // closing the last editor window still quits
+        _findAllWindow->setAttribute(Qt::WA_QuitOnClose, false);
+    }
+
+    if (!text.isEmpty()) {
+        _findAllWindow->setText(text);
+    }
+    _findAllWindow->show();
+    _findAllWindow->raise();
+    _findAllWindow->activateWindow();
+    _findAllWindow->setFocus();
+}
+
+
 void Application::loadSettings()
 {
     for (MainWindow* win : qAsConst(_windows)) {
@@ -14,9 +14,16 @@
 #include <QApplication>
 #include <QList>
 
+class FindAllWindow;
 class MainWindow;
 class QFileSystemWatcher;
 class QStringList;
+class QThread;
+class SyntaxResolver;
+
+namespace KSyntaxHighlighting {
+class Repository;
+}
 
 
 class Application : public QApplication
@@ -25,15 +32,34 @@ class Application : public QApplication
 
 public:
     Application(int &argc, char *argv[]);
+    ~Application();
 
     static Application* instance();
 
+    // the syntax definitions, shared by all the windows. They start loading
+    // in a worker thread with the application: this waits for them, if needed
+    KSyntaxHighlighting::Repository* highlightingRepository();
+
+    // finds (and caches) the syntax definitions of the files
+    SyntaxResolver* syntaxResolver();
+
     void parseCommandlineArgs();
 
+    // offers to recover the edits of a crashed session,
+    // returns true if (at least) a window has been opened
+    bool recoverJournals();
+
     void loadPaths(const QStringList& paths);
     void loadPath(const QString& path);
 
+    // loads path (if needed) and moves its cursor to line (1 based)
+    void gotoLine(const QString& path, int line);
+
     void removeWindowFromList(MainWindow* w);
+    inline QList<MainWindow*> windows() const { return _windows; }
+
+    // one for all the windows; text (when not empty) goes in its search field
+    void showFindAllWindow(const QString& text);
 
     void loadSettings();
 
@@ -47,6 +73,11 @@ private Q_SLOTS:
 private:
     QList<MainWindow*> _windows;
     QFileSystemWatcher* _watcher;
+    FindAllWindow* _findAllWindow;
+
+    QThread* _repositoryThread;
+    KSyntaxHighlighting::Repository* _repository;
+    SyntaxResolver* _syntaxResolver;
 };
 
 #endif // APPLICATION_H
@@ -25,3 +25,9 @@ void CutepadAdaptor::loadPaths(const QStringList &paths)
 {
     _app->loadPaths(paths);
 }
+
+
+void CutepadAdaptor::gotoLine(const QString &path, int line)
+{
+    _app->gotoLine(path, line);
+}
@@ -26,6 +26,7 @@ public:
 
 public Q_SLOTS:
     Q_SCRIPTABLE void loadPaths(const QStringList &paths);
+    Q_SCRIPTABLE void gotoLine(const QString &path, int line);
 
 private:
     Application* _app;
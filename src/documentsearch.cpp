@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "documentsearch.h"
+
+#include "searchengine.h"
+
+#include <QRunnable>
+
+
+class DocumentSearchTask : public QRunnable
+{
+public:
+    DocumentSearchTask(DocumentSearch* search, int generation, const QSharedPointer<QAtomicInt>& results, int document,
+                       const QString& source, const QString& text, const QString& pattern, Qt::CaseSensitivity cs)
+        : _search(search)
+        , _generation(generation)
+        , _results(results)
+        , _document(document)
+        , _source(source)
+        , _text(text)
+        , _pattern(pattern)
+        , _cs(cs)
+    {
+    }
+
+    void run() override
+    {
+        SearchEngine engine;
+        engine.setPattern(_pattern, _cs);
+
+        const ushort* data = _text.utf16();
+        const qint64 size = _text.size();
+
+        QVector<SearchResult> batch;
+        int line = 0;
+        qint64 lineStart = 0;
+        qint64 lineEnd = -1;
+        qint64 counted = 0;
+
+        qint64 position = engine.indexIn(data, size, 0);
+        while (position >= 0) {
+            if (_search->isCancelled(_generation) || _results->fetchAndAddRelaxed(1) >= DocumentSearch::MaxResults) {
+                break;
+            }
+
+            // lines are counted from the previous match on
+            for (; counted < position; ++counted) {
+                if (data[counted] == '\n') {
+                    ++line;
+                    lineStart = counted + 1;
+                }
+            }
+
+            // long lines are cut around the match: the end of a line
+            // is looked for once, by its first match
+            if (lineEnd < position) {
+                for (lineEnd = position; lineEnd < size && data[lineEnd] != '\n'; ++lineEnd) {
+                }
+            }
+            const qint64 previewStart = qMax(lineStart, position - DocumentSearch::PreviewLength / 2);
+            const qint64 previewLength = qMin(lineEnd - previewStart, qint64(DocumentSearch::PreviewLength));
+
+            SearchResult result = { _source, _document, line, int(position - lineStart), int(position), _pattern.length(),
+                                    _text.mid(int(previewStart), int(previewLength)).trimmed() };
+            batch.append(result);
+            if (batch.size() == DocumentSearch::BatchSize) {
+                _search->post(_generation, batch, false);
+                batch.clear();
+            }
+
+            position = engine.indexIn(data, size, position + _pattern.length());
+        }
+
+        _search->post(_generation, batch, true);
+    }
+
+private:
+    DocumentSearch* _search;
+    int _generation;
+    QSharedPointer<QAtomicInt> _results;
+    int _document;
+    QString _source;
+    QString _text;
+    QString _pattern;
+    Qt::CaseSensitivity _cs;
+};
+
+
+// ------------------------------------------------------------------------------------
+
+
+DocumentSearch::DocumentSearch(QObject *parent)
+    : QObject(parent)
+    , _generation(0)
+    , _running(0)
+{
+    qRegisterMetaType<QVector<SearchResult> >();
+}
+
+
+DocumentSearch::~DocumentSearch()
+{
+    // the tasks post to us: they must be over
+    cancel();
+    _pool.waitForDone();
+}
+
+
+void DocumentSearch::start(const QStringList& sources, const QStringList& texts, const QString& pattern, Qt::CaseSensitivity cs)
+{
+    cancel();
+
+    const int generation = _generation.loadAcquire();
+    _results.reset(new QAtomicInt(0));
+    _running = texts.size();
+    if (_running == 0 || pattern.isEmpty()) {
+        _running = 0;
+        Q_EMIT finished(false);
+        return;
+    }
+
+    for (int i = 0; i < texts.size(); ++i) {
+        _pool.start(new DocumentSearchTask(this, generation, _results, i, sources.value(i), texts.at(i), pattern, cs));
+    }
+}
+
+
+void DocumentSearch::cancel()
+{
+    _generation.fetchAndAddOrdered(1);
+    _running = 0;
+}
+
+
+bool DocumentSearch::isCancelled(int generation) const
+{
+    return _generation.loadAcquire() != generation;
+}
+
+
+void DocumentSearch::post(int generation, const QVector<SearchResult>& results, bool last)
+{
+    QMetaObject::invokeMethod(this, [this, generation, results, last]() {
+            if (isCancelled(generation)) {
+                return;
+            }
+            if (!results.isEmpty()) {
+                Q_EMIT resultsFound(results);
+            }
+            if (last && --_running == 0) {
+                Q_EMIT finished(_results->loadAcquire() > MaxResults);
+            }
+        }, Qt::QueuedConnection);
+}
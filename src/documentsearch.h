@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef DOCUMENTSEARCH_H
+#define DOCUMENTSEARCH_H
+
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include "searchresultsmodel.h"
+
+
+// Searches many documents at once, one task per document on a thread
+// pool using all the cores. Documents are plain text snapshots (shared,
+// not copied); results are handed back in batches with resultsFound().
+class DocumentSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DocumentSearch(QObject *parent = nullptr);
+    ~DocumentSearch();
+
+    // searches texts for pattern: the results of texts[i] have document i
+    // and source sources[i]. The running search, if any, is cancelled
+    void start(const QStringList& sources, const QStringList& texts, const QString& pattern, Qt::CaseSensitivity cs);
+
+    void cancel();
+
+    inline bool isRunning() const { return _running > 0; };
+
+    // results kept, at most: the search stops there
+    static const int MaxResults = 100000;
+    // results in a batch, at most
+    static const int BatchSize = 1000;
+    // characters of a line shown around a match
+    static const int PreviewLength = 200;
+
+Q_SIGNALS:
+    void resultsFound(const QVector<SearchResult>& results);
+
+    // truncated is true when the search stopped at MaxResults
+    void finished(bool truncated);
+
+private:
+    friend class DocumentSearchTask;
+
+    // both thread safe, called by the tasks
+    bool isCancelled(int generation) const;
+    void post(int generation, const QVector<SearchResult>& results, bool last);
+
+    QThreadPool _pool;
+
+    // a new search (or a cancel) makes the running tasks stale
+    QAtomicInt _generation;
+    int _running;
+
+    // the results of the running search, counted by its tasks
+    QSharedPointer<QAtomicInt> _results;
+};
+
+
+#endif // DOCUMENTSEARCH_H
@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "editjournal.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTimer>
+#include <QUuid>
+
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+
+static const char JournalMagic[] = "CUTEPADJ";
+static const qint32 JournalVersion = 1;
+
+// pending bytes forcing a sync, not waiting for the timer
+static const int MaxPendingBytes = 1024 * 1024;
+
+// the removed length of a record replacing the whole document
+static const qint32 WholeDocument = -1;
+
+
+static QString journalDir()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/journal");
+}
+
+
+EditJournal::EditJournal(QTextDocument* document, QObject *parent)
+    : QObject(parent)
+    , _document(document)
+    , _recording(false)
+    , _baseSize(0)
+    , _baseModified(0)
+    , _syncTimer(new QTimer(this))
+    , _revision(0)
+    , _undoSteps(0)
+    , _redoSteps(0)
+{
+    _syncTimer->setSingleShot(true);
+    _syncTimer->setInterval(SyncInterval);
+    connect(_syncTimer, &QTimer::timeout, this, &EditJournal::sync);
+
+    connect(_document, &QTextDocument::contentsChange, this, &EditJournal::record);
+}
+
+
+EditJournal::~EditJournal()
+{
+    // not discarded: the window did not close cleanly, keep what we have
+    sync();
+}
+
+
+void EditJournal::start(const QString& basePath)
+{
+    discard();
+
+    _basePath = basePath;
+    _recording = true;
+
+    // the file as loaded (or saved): it can change before the first edit
+    _baseSize = 0;
+    _baseModified = 0;
+    if (!_basePath.isEmpty()) {
+        QFileInfo info(_basePath);
+        _baseSize = info.size();
+        _baseModified = info.lastModified().toMSecsSinceEpoch();
+    }
+
+    _revision = _document->revision();
+    _undoSteps = _document->availableUndoSteps();
+    _redoSteps = _document->availableRedoSteps();
+}
+
+
+void EditJournal::discard()
+{
+    _recording = false;
+    _syncTimer->stop();
+    _pending.clear();
+
+    if (_file.isOpen()) {
+        _file.close();
+        _file.remove();
+    }
+}
+
+
+void EditJournal::recordDocument()
+{
+    if (_recording) {
+        append(0, WholeDocument, _document->toPlainText());
+    }
+}
+
+
+bool EditJournal::recover(const QString& journal)
+{
+    discard();
+
+    QString basePath;
+    if (!readBase(journal, &basePath)) {
+        return false;
+    }
+
+    QFile file(journal);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qDebug() << "cannot open journal" << journal << ":" << file.errorString();
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    QByteArray magic;
+    qint32 version;
+    QString path;
+    qint64 baseSize;
+    qint64 baseModified;
+    in >> magic >> version >> path >> baseSize >> baseModified;
+
+    // the replay is a single (undoable) edit
+    QTextCursor cursor(_document);
+    cursor.beginEditBlock();
+
+    int records = 0;
+    qint64 validSize = file.pos();
+    while (!in.atEnd()) {
+        qint32 position;
+        qint32 removed;
+        QString text;
+        in >> position >> removed >> text;
+
+        // the crash can leave a half written record
+        if (in.status() != QDataStream::Ok) {
+            break;
+        }
+
+        const int end = _document->characterCount() - 1;
+        if (removed == WholeDocument) {
+            cursor.setPosition(0);
+            cursor.setPosition(end, QTextCursor::KeepAnchor);
+        } else {
+            cursor.setPosition( qMin(int(position), end) );
+            cursor.setPosition( qMin(int(position + removed), end), QTextCursor::KeepAnchor);
+        }
+        cursor.insertText(text);
+
+        validSize = file.pos();
+        ++records;
+    }
+
+    cursor.endEditBlock();
+    qDebug() << "replayed" << records << "edits from" << journal;
+
+    // go on recording in the recovered journal
+    file.resize(validSize);
+    file.close();
+
+    _file.setFileName(journal);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "cannot reopen journal" << journal << ":" << _file.errorString();
+        return true;
+    }
+
+    _basePath = basePath;
+    _baseSize = baseSize;
+    _baseModified = baseModified;
+    _recording = true;
+    _revision = _document->revision();
+    _undoSteps = _document->availableUndoSteps();
+    _redoSteps = _document->availableRedoSteps();
+    return true;
+}
+
+
+QStringList EditJournal::orphans()
+{
+    // there is just one cutepad instance (see main.cpp): when it starts,
+    // all the journals around have been left by a crashed one
+    QDir dir(journalDir());
+    QStringList journals;
+    const QStringList names = dir.entryList(QStringList() << QStringLiteral("*.journal"), QDir::Files, QDir::Time | QDir::Reversed);
+    for (const QString& name : names) {
+        journals << dir.absoluteFilePath(name);
+    }
+    return journals;
+}
+
+
+bool EditJournal::readBase(const QString& journal, QString* basePath)
+{
+    QFile file(journal);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    QByteArray magic;
+    qint32 version;
+    qint64 baseSize;
+    qint64 baseModified;
+    in >> magic >> version >> *basePath >> baseSize >> baseModified;
+
+    if (in.status() != QDataStream::Ok || magic != JournalMagic || version != JournalVersion) {
+        qDebug() << "invalid journal" << journal;
+        return false;
+    }
+
+    // edits are replayed over the base file: it must be the same
+    if (!basePath->isEmpty()) {
+        QFileInfo info(*basePath);
+        if (!info.exists() || info.size() != baseSize || info.lastModified().toMSecsSinceEpoch() != baseModified) {
+            qDebug() << "base file of journal" << journal << "changed";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void EditJournal::record(int position, int charsRemoved, int charsAdded)
+{
+    if (!_recording) {
+        return;
+    }
+
+    // the highlighter changes just formats: same lengths, same undo state
+    const int revision = _document->revision();
+    const int undoSteps = _document->availableUndoSteps();
+    const int redoSteps = _document->availableRedoSteps();
+    if (charsRemoved == charsAdded && revision == _revision && undoSteps == _undoSteps && redoSteps == _redoSteps) {
+        return;
+    }
+    _revision = revision;
+    _undoSteps = undoSteps;
+    _redoSteps = redoSteps;
+
+    // lengths can count the final paragraph separator, too
+    const int end = _document->characterCount() - 1;
+    QTextCursor cursor(_document);
+    cursor.setPosition( qMin(position, end) );
+    cursor.setPosition( qMin(position + charsAdded, end), QTextCursor::KeepAnchor);
+
+    QString text = cursor.selectedText();
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+
+    append(position, charsRemoved, text);
+}
+
+
+void EditJournal::append(int position, int charsRemoved, const QString& text)
+{
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << qint32(position) << qint32(charsRemoved) << text;
+
+    _pending += record;
+
+    if (_pending.size() > MaxPendingBytes) {
+        sync();
+    } else if (!_syncTimer->isActive()) {
+        _syncTimer->start();
+    }
+}
+
+
+void EditJournal::sync()
+{
+    _syncTimer->stop();
+
+    if (_pending.isEmpty()) {
+        return;
+    }
+
+    if (!_file.isOpen() && !openJournal()) {
+        _pending.clear();
+        return;
+    }
+
+    if (_file.write(_pending) != _pending.size() || !_file.flush()) {
+        qDebug() << "cannot write journal" << _file.fileName() << ":" << _file.errorString();
+    }
+    _pending.clear();
+
+#ifdef Q_OS_UNIX
+    ::fsync(_file.handle());
+#endif
+}
+
+
+bool EditJournal::openJournal()
+{
+    const QString dir = journalDir();
+    QDir().mkpath(dir);
+
+    _file.setFileName(dir + QLatin1Char('/') + QUuid::createUuid().toString(QUuid::WithoutBraces) + QStringLiteral(".journal"));
+    if (!_file.open(QIODevice::WriteOnly)) {
+        qDebug() << "cannot create journal" << _file.fileName() << ":" << _file.errorString();
+        _recording = false;
+        return false;
+    }
+
+    QDataStream out(&_file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << QByteArray(JournalMagic) << JournalVersion << _basePath << _baseSize << _baseModified;
+    return true;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+
+#include <QByteArray>
+#include <QFile>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QTextDocument;
+class QTimer;
+
+
+// Write-ahead journal of the edits of a document, for crash recovery.
+// Every QTextDocument::contentsChange is appended (as position, removed
+// length and added text) to a file under AppDataLocation/journal and the
+// file is synced to disk in batches: the cost of an edit does not depend
+// on the document size, as a full autosave would.
+// A journal left by a crashed session is replayed over its base file.
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EditJournal(QTextDocument* document, QObject *parent = nullptr);
+    ~EditJournal();
+
+    // starts recording the edits made over basePath (empty for a new document).
+    // The journal file is created on the first edit
+    void start(const QString& basePath);
+
+    // stops recording and removes the journal file
+    void discard();
+
+    // records the whole document: used when its base file is no more
+    // in sync with the edits (e.g. edited while saving)
+    void recordDocument();
+
+    // replays journal over the document (already loaded with its base file),
+    // then goes on recording in it
+    bool recover(const QString& journal);
+
+    // journals left by a crashed session
+    static QStringList orphans();
+
+    // the base file of journal, false if it cannot be read
+    // or the base file has been modified after the journal started
+    static bool readBase(const QString& journal, QString* basePath);
+
+    static const int SyncInterval = 1000;
+
+private Q_SLOTS:
+    void record(int position, int charsRemoved, int charsAdded);
+    void sync();
+
+private:
+    void append(int position, int charsRemoved, const QString& text);
+    bool openJournal();
+
+    QTextDocument* _document;
+
+    bool _recording;
+    QString _basePath;
+
+    // the base file when the recording started: edits are replayed over it
+    qint64 _baseSize;
+    qint64 _baseModified;
+
+    QFile _file;
+    QByteArray _pending;
+    QTimer* _syncTimer;
+
+    // to tell edits from the highlighter just marking the text dirty
+    int _revision;
+    int _undoSteps;
+    int _redoSteps;
+};
+
+
+#endif // EDITJOURNAL_H
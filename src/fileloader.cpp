@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "fileloader.h"
+
+#include "simdtext.h"
+#include "textcodec.h"
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QTextCodec>
+
+#include <QDebug>
+
+#include <cstring>
+
+
+FileLoader::FileLoader(const QString& path, QObject *parent)
+    : QObject(parent)
+    , _path(path)
+    , _cancelled(0)
+    , _freeSlots(MaxPendingChunks)
+{
+}
+
+
+void FileLoader::chunkConsumed()
+{
+    _freeSlots.release();
+}
+
+
+void FileLoader::cancel()
+{
+    _cancelled.storeRelease(1);
+}
+
+
+void FileLoader::load()
+{
+    QFile file(_path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "cannot open" << _path;
+        Q_EMIT finished(false);
+        return;
+    }
+
+    const qint64 total = file.size();
+    int lastPercent = -1;
+
+    QByteArray chunk = file.read(ChunkSize);
+
+    // the first chunk is enough to look for BOM and HTML meta
+    QTextCodec* codec = TextCodec::codecForByteArray(chunk);
+    Q_EMIT codecDetected(codec->name());
+
+    // UTF-8 and Latin-1 are decoded by SimdText kernels, straight into
+    // the chunk QString. Any other codec goes through a QTextDecoder
+    Kernel kernel = GenericKernel;
+    if (codec->mibEnum() == 106) {
+        kernel = Utf8Kernel;
+    } else if (codec->mibEnum() == 4) {
+        kernel = Latin1Kernel;
+    }
+
+    // the decoder keeps its state between chunks, so multibyte
+    // sequences split on a chunk boundary are decoded correctly
+    QScopedPointer<QTextDecoder> decoder(kernel == GenericKernel ? codec->makeDecoder() : nullptr);
+
+    // as QTextCodec does, the UTF-8 BOM is not part of the text
+    int skip = 0;
+    if (kernel == Utf8Kernel && chunk.startsWith("\xEF\xBB\xBF")) {
+        skip = 3;
+    }
+
+    // UTF-8 bytes of a sequence split by the chunk boundary
+    QByteArray pending;
+
+    while (!chunk.isEmpty()) {
+        QString text;
+        switch (kernel) {
+        case Utf8Kernel: {
+            int complete = chunk.size();
+            if (!file.atEnd()) {
+                complete -= SimdText::incompleteUtf8Tail(chunk.constData(), chunk.size());
+            }
+            text = QString(complete - skip, Qt::Uninitialized);
+            qint64 written = SimdText::decodeUtf8(chunk.constData() + skip, complete - skip, reinterpret_cast<ushort*>(text.data()));
+            text.truncate(int(written));
+            pending = chunk.mid(complete);
+            skip = 0;
+            break;
+        }
+        case Latin1Kernel:
+            text = QString(chunk.size(), Qt::Uninitialized);
+            SimdText::decodeLatin1(chunk.constData(), chunk.size(), reinterpret_cast<ushort*>(text.data()));
+            break;
+        default:
+            text = decoder->toUnicode(chunk);
+            break;
+        }
+
+        if (!waitForFreeSlot()) {
+            Q_EMIT finished(false);
+            return;
+        }
+        Q_EMIT textDecoded(text);
+
+        int percent = total > 0 ? int(file.pos() * 100 / total) : 100;
+        if (percent != lastPercent) {
+            lastPercent = percent;
+            Q_EMIT progress(percent);
+        }
+
+        chunk = readChunk(file, pending);
+    }
+
+    Q_EMIT finished(true);
+}
+
+
+QByteArray FileLoader::readChunk(QFile & file, const QByteArray & pending)
+{
+    if (pending.isEmpty()) {
+        return file.read(ChunkSize);
+    }
+
+    // read right after the pending bytes
+    QByteArray chunk(pending.size() + ChunkSize, Qt::Uninitialized);
+    memcpy(chunk.data(), pending.constData(), pending.size());
+    qint64 read = file.read(chunk.data() + pending.size(), ChunkSize);
+    chunk.resize(pending.size() + int(qMax<qint64>(0, read)));
+    return chunk;
+}
+
+
+bool FileLoader::waitForFreeSlot()
+{
+    // don't flood the GUI event queue: wait until it has appended
+    // the previous chunks, checking for cancellation in the meanwhile
+    while (!_freeSlots.tryAcquire(1, 50)) {
+        if (_cancelled.loadAcquire()) {
+            return false;
+        }
+    }
+    return !_cancelled.loadAcquire();
+}
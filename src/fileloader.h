@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef FILELOADER_H
+#define FILELOADER_H
+
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QSemaphore>
+
+class QFile;
+
+// Reads and decodes a file in fixed-size chunks.
+// It is meant to live in a worker thread: decoded text is handed
+// to the GUI thread with the textDecoded() signal, at most
+// MaxPendingChunks at a time (the receiver calls chunkConsumed()
+// when a chunk has been appended to the document).
+class FileLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileLoader(const QString& path, QObject *parent = nullptr);
+
+    // both thread safe, called from the GUI thread
+    void chunkConsumed();
+    void cancel();
+
+    static const int ChunkSize = 512 * 1024;
+    static const int MaxPendingChunks = 2;
+
+public Q_SLOTS:
+    void load();
+
+Q_SIGNALS:
+    void codecDetected(const QByteArray& codecName);
+    void textDecoded(const QString& text);
+    void progress(int percent);
+
+    // completed is false when loading has been cancelled or failed
+    void finished(bool completed);
+
+private:
+    enum Kernel {
+        GenericKernel,
+        Utf8Kernel,
+        Latin1Kernel
+    };
+
+    QByteArray readChunk(QFile & file, const QByteArray & pending);
+    bool waitForFreeSlot();
+
+    QString _path;
+
+    QAtomicInt _cancelled;
+    QSemaphore _freeSlots;
+};
+
+#endif // FILELOADER_H
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "filesaver.h"
+
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <QTextCodec>
+
+#include <QDebug>
+
+
+FileSaver::FileSaver(const QString& path, const QString& content, QTextCodec* codec, QObject *parent)
+    : QObject(parent)
+    , _path(path)
+    , _content(content)
+    , _codec(codec)
+    , _cancelled(0)
+{
+    qRegisterMetaType<FileSaver::Result>();
+}
+
+
+FileSaver::FileSaver(const QString& path, const PieceTable& pieces, QObject *parent)
+    : QObject(parent)
+    , _path(path)
+    , _codec(nullptr)
+    , _pieces(pieces)
+    , _cancelled(0)
+{
+    qRegisterMetaType<FileSaver::Result>();
+}
+
+
+void FileSaver::cancel()
+{
+    _cancelled.storeRelease(1);
+}
+
+
+void FileSaver::save()
+{
+    QSaveFile file(_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "cannot save" << _path << ":" << file.errorString();
+        Q_EMIT finished(Failed);
+        return;
+    }
+
+    // no codec: writing a piece table
+    bool written = _codec ? writeText(file) : writePieces(file);
+    if (!written) {
+        file.cancelWriting();
+        Q_EMIT finished(_cancelled.loadAcquire() ? Cancelled : Failed);
+        return;
+    }
+
+    // commit() flushes, syncs the data to disk and then
+    // renames the temporary file over the target one
+    if (!file.commit()) {
+        qDebug() << "cannot commit" << _path << ":" << file.errorString();
+        Q_EMIT finished(Failed);
+        return;
+    }
+
+    Q_EMIT finished(Saved);
+}
+
+
+bool FileSaver::writeText(QSaveFile& file)
+{
+    // the first chunk is encoded exactly as a whole document would be (BOM included),
+    // the following ones by an encoder that skips the header
+    QScopedPointer<QTextEncoder> encoder(_codec->makeEncoder(QTextCodec::IgnoreHeader));
+
+    const int total = _content.size();
+    int position = 0;
+    int lastPercent = -1;
+
+    while (position < total) {
+        if (_cancelled.loadAcquire()) {
+            return false;
+        }
+
+        int length = qMin(ChunkSize, total - position);
+
+        // never split a surrogate pair
+        if (position + length < total && _content.at(position + length - 1).isHighSurrogate()) {
+            length++;
+        }
+
+        const QChar* chunk = _content.constData() + position;
+        QByteArray bytes = (position == 0) ? _codec->fromUnicode(chunk, length) : encoder->fromUnicode(chunk, length);
+        if (file.write(bytes) != bytes.size()) {
+            qDebug() << "cannot write" << _path << ":" << file.errorString();
+            return false;
+        }
+
+        position += length;
+
+        int percent = int(qint64(position) * 100 / total);
+        if (percent != lastPercent) {
+            lastPercent = percent;
+            Q_EMIT progress(percent);
+        }
+    }
+
+    // an empty document still needs its header (e.g. UTF-16 BOM)
+    if (total == 0) {
+        file.write(_codec->fromUnicode(_content));
+    }
+
+    return true;
+}
+
+
+bool FileSaver::writePieces(QSaveFile& file)
+{
+    const qint64 total = _pieces.size();
+    qint64 position = 0;
+    int lastPercent = -1;
+
+    // pieces can be huge (the whole original file): write them in chunks
+    return _pieces.write([&](const char* data, qint64 length) -> bool {
+        while (length > 0) {
+            if (_cancelled.loadAcquire()) {
+                return false;
+            }
+
+            const qint64 chunk = qMin<qint64>(ChunkSize, length);
+            if (file.write(data, chunk) != chunk) {
+                qDebug() << "cannot write" << _path << ":" << file.errorString();
+                return false;
+            }
+
+            data += chunk;
+            length -= chunk;
+            position += chunk;
+
+            int percent = int(position * 100 / total);
+            if (percent != lastPercent) {
+                lastPercent = percent;
+                Q_EMIT progress(percent);
+            }
+        }
+        return true;
+    });
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef FILESAVER_H
+#define FILESAVER_H
+
+
+#include "piecetable.h"
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QString>
+
+class QSaveFile;
+class QTextCodec;
+
+
+// Encodes and writes a snapshot of a document in chunks.
+// It is meant to live in a worker thread and writes through a QSaveFile:
+// the target file is replaced (synced and atomically renamed) only
+// when everything has been written, so a crash never truncates it.
+// A PieceTable snapshot is written as it is: its bytes are already encoded.
+class FileSaver : public QObject
+{
+    Q_OBJECT
+
+public:
+    FileSaver(const QString& path, const QString& content, QTextCodec* codec, QObject *parent = nullptr);
+    FileSaver(const QString& path, const PieceTable& pieces, QObject *parent = nullptr);
+
+    enum Result {
+        Saved,
+        Failed,
+        Cancelled
+    };
+    Q_ENUM(Result)
+
+    // thread safe, called from the GUI thread:
+    // the target file is left untouched
+    void cancel();
+
+    static const int ChunkSize = 1024 * 1024;
+
+public Q_SLOTS:
+    void save();
+
+Q_SIGNALS:
+    void progress(int percent);
+    void finished(FileSaver::Result result);
+
+private:
+    bool writeText(QSaveFile& file);
+    bool writePieces(QSaveFile& file);
+
+    QString _path;
+    QString _content;
+    QTextCodec* _codec;
+    PieceTable _pieces;
+
+    QAtomicInt _cancelled;
+};
+
+#endif // FILESAVER_H
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "filesearch.h"
+
+#include "searchengine.h"
+#include "simdtext.h"
+#include "textcodec.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QTextCodec>
+#include <QTextDecoder>
+
+#include <cstring>
+
+
+static bool matchesAny(const QVector<QRegularExpression>& globs, const QString& name)
+{
+    for (const QRegularExpression& glob : globs) {
+        if (glob.match(name).hasMatch()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+class DirectorySearchTask : public QRunnable
+{
+public:
+    DirectorySearchTask(FileSearch* search, const QSharedPointer<FileSearch::Job>& job, const QString& directory)
+        : _search(search)
+        , _job(job)
+        , _directory(directory)
+    {
+    }
+
+    void run() override
+    {
+        _engine.setPattern(_job->pattern, _job->cs);
+
+        QDirIterator it(_directory, QDir::Files | QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot);
+        while (it.hasNext() && !stopped()) {
+            const QString path = it.next();
+            const QString name = it.fileName();
+            if (matchesAny(_job->excludes, name)) {
+                continue;
+            }
+
+            // links can make cycles
+            const QFileInfo info = it.fileInfo();
+            if (info.isSymLink()) {
+                continue;
+            }
+
+            if (info.isDir()) {
+                _search->queue(_job, path);
+            } else if (_job->includes.isEmpty() || matchesAny(_job->includes, name)) {
+                searchFile(path);
+            }
+        }
+
+        if (!_batch.isEmpty()) {
+            _search->post(_job->generation, _batch);
+        }
+        _search->taskFinished(_job);
+    }
+
+private:
+    bool stopped() const
+    {
+        return _search->isCancelled(_job->generation) || _job->results.loadAcquire() >= FileSearch::MaxResults;
+    }
+
+    void searchFile(const QString& path)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return;
+        }
+        const qint64 size = file.size();
+        if (size == 0) {
+            return;
+        }
+
+        // unmapped when file goes
+        const uchar* data = file.map(0, size);
+        if (!data) {
+            return;
+        }
+        const char* bytes = reinterpret_cast<const char*>(data);
+
+        // guessed as when loading, but on a sample: the file can be huge
+        const QByteArray sample = QByteArray::fromRawData(bytes, int(qMin(size, qint64(FileSearch::SampleSize))));
+        QTextCodec* codec = TextCodec::codecForByteArray(sample, false);
+
+        // a NUL byte means binary, but in UTF-16 and UTF-32 text
+        const int mib = codec->mibEnum();
+        const bool wide = (mib >= 1013 && mib <= 1019);
+        if (!wide && std::memchr(bytes, 0, sample.size())) {
+            return;
+        }
+        _job->files.ref();
+
+        // the same kernels of the FileLoader
+        const bool utf8 = (mib == 106);
+        const bool latin1 = (mib == 4);
+        QScopedPointer<QTextDecoder> decoder((utf8 || latin1) ? nullptr : codec->makeDecoder());
+
+        qint64 offset = 0;
+        if (utf8 && sample.startsWith("\xEF\xBB\xBF")) {
+            offset = 3;
+        }
+
+        // the end of the previous chunk, for the matches across chunks
+        const int length = _job->pattern.length();
+        QString tail;
+        qint64 tailStart = 0;
+
+        int line = 0;
+        qint64 lineStart = 0;
+
+        while (offset < size) {
+            if (stopped()) {
+                return;
+            }
+
+            qint64 chunkSize = qMin(qint64(FileSearch::ChunkSize), size - offset);
+            QString decoded;
+            if (utf8) {
+                if (offset + chunkSize < size) {
+                    chunkSize -= SimdText::incompleteUtf8Tail(bytes + offset, chunkSize);
+                }
+                decoded = QString(int(chunkSize), Qt::Uninitialized);
+                const qint64 written = SimdText::decodeUtf8(bytes + offset, chunkSize, reinterpret_cast<ushort*>(decoded.data()));
+                decoded.truncate(int(written));
+            } else if (latin1) {
+                decoded = QString(int(chunkSize), Qt::Uninitialized);
+                SimdText::decodeLatin1(bytes + offset, chunkSize, reinterpret_cast<ushort*>(decoded.data()));
+            } else {
+                decoded = decoder->toUnicode(bytes + offset, int(chunkSize));
+            }
+            offset += chunkSize;
+
+            const QString text = tail + decoded;
+            const qint64 textStart = tailStart;
+            const ushort* units = text.utf16();
+
+            // the tail lines have been counted already
+            int counted = tail.size();
+            int lineEnd = -1;
+            qint64 position = _engine.indexIn(units, text.size(), 0);
+            while (position >= 0) {
+                for (; counted < position; ++counted) {
+                    if (units[counted] == '\n') {
+                        ++line;
+                        lineStart = textStart + counted + 1;
+                    }
+                }
+                // looked for once, by the first match of the line
+                if (lineEnd < position) {
+                    for (lineEnd = int(position); lineEnd < text.size() && units[lineEnd] != '\n'; ++lineEnd) {
+                    }
+                }
+                if (!addResult(path, text, textStart, int(position), line, lineStart, lineEnd)) {
+                    return;
+                }
+                position = _engine.indexIn(units, text.size(), position + length);
+            }
+            for (; counted < text.size(); ++counted) {
+                if (units[counted] == '\n') {
+                    ++line;
+                    lineStart = textStart + counted + 1;
+                }
+            }
+
+            tail = text.right(length - 1);
+            tailStart = textStart + text.size() - tail.size();
+        }
+    }
+
+    // false when there are enough results; lineEnd is the end of the
+    // line in text (or of text)
+    bool addResult(const QString& path, const QString& text, qint64 textStart, int position, int line, qint64 lineStart, int lineEnd)
+    {
+        if (_job->results.fetchAndAddRelaxed(1) >= FileSearch::MaxResults) {
+            return false;
+        }
+
+        // long lines are cut around the match
+        const qint64 match = textStart + position;
+        const int previewStart = int(qMax(qMax(lineStart, textStart), match - FileSearch::PreviewLength / 2) - textStart);
+        const int previewLength = qMin(lineEnd - previewStart, int(FileSearch::PreviewLength));
+
+        SearchResult result = { path, -1, line, int(match - lineStart), -1, _job->pattern.length(),
+                                text.mid(previewStart, previewLength).trimmed() };
+        _batch.append(result);
+        if (_batch.size() == FileSearch::BatchSize) {
+            _search->post(_job->generation, _batch);
+            _batch.clear();
+        }
+        return true;
+    }
+
+    FileSearch* _search;
+    QSharedPointer<FileSearch::Job> _job;
+    QString _directory;
+
+    SearchEngine _engine;
+    QVector<SearchResult> _batch;
+};
+
+
+// ------------------------------------------------------------------------------------
+
+
+FileSearch::FileSearch(QObject *parent)
+    : QObject(parent)
+    , _generation(0)
+    , _running(false)
+{
+    qRegisterMetaType<QVector<SearchResult> >();
+}
+
+
+FileSearch::~FileSearch()
+{
+    // the tasks post to us: they must be over
+    cancel();
+    _pool.waitForDone();
+}
+
+
+void FileSearch::start(const QString& root, const QString& pattern, Qt::CaseSensitivity cs,
+                       const QStringList& includes, const QStringList& excludes)
+{
+    cancel();
+
+    QSharedPointer<Job> job(new Job);
+    job->generation = _generation.loadAcquire();
+    job->pattern = pattern;
+    job->cs = cs;
+    for (const QString& glob : includes) {
+        job->includes.append( QRegularExpression(QRegularExpression::wildcardToRegularExpression(glob)) );
+    }
+    for (const QString& glob : excludes) {
+        job->excludes.append( QRegularExpression(QRegularExpression::wildcardToRegularExpression(glob)) );
+    }
+
+    _running = true;
+    queue(job, root);
+}
+
+
+void FileSearch::cancel()
+{
+    _generation.fetchAndAddOrdered(1);
+    _running = false;
+}
+
+
+bool FileSearch::isCancelled(int generation) const
+{
+    return _generation.loadAcquire() != generation;
+}
+
+
+void FileSearch::queue(const QSharedPointer<Job>& job, const QString& directory)
+{
+    job->pendingTasks.ref();
+    _pool.start(new DirectorySearchTask(this, job, directory));
+}
+
+
+void FileSearch::post(int generation, const QVector<SearchResult>& results)
+{
+    QMetaObject::invokeMethod(this, [this, generation, results]() {
+            if (!isCancelled(generation)) {
+                Q_EMIT resultsFound(results);
+            }
+        }, Qt::QueuedConnection);
+}
+
+
+void FileSearch::taskFinished(const QSharedPointer<Job>& job)
+{
+    // the last task of the search
+    if (job->pendingTasks.deref()) {
+        return;
+    }
+
+    const int generation = job->generation;
+    const int files = job->files.loadAcquire();
+    const bool truncated = job->results.loadAcquire() >= MaxResults;
+    QMetaObject::invokeMethod(this, [this, generation, files, truncated]() {
+            if (!isCancelled(generation)) {
+                _running = false;
+                Q_EMIT finished(files, truncated);
+            }
+        }, Qt::QueuedConnection);
+}
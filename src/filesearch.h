@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef FILESEARCH_H
+#define FILESEARCH_H
+
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include "searchresultsmodel.h"
+
+
+// Searches the files of a directory tree on a thread pool.
+// Every directory is a task: it lists its entries, queues a task for
+// each subdirectory and searches its files. A file is mapped in memory,
+// skipped when it looks binary, decoded (with the codec guessed as when
+// loading it) in chunks and searched with a SearchEngine, so the memory
+// used does not depend on the size of the tree, nor of its files.
+class FileSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileSearch(QObject *parent = nullptr);
+    ~FileSearch();
+
+    // searches the files under root, whose names match one of the include
+    // globs (any, when empty): files and directories whose names match one
+    // of the exclude globs are skipped. The running search is cancelled
+    void start(const QString& root, const QString& pattern, Qt::CaseSensitivity cs,
+               const QStringList& includes, const QStringList& excludes);
+
+    void cancel();
+
+    inline bool isRunning() const { return _running; };
+
+    // results kept, at most: the search stops there
+    static const int MaxResults = 100000;
+    // results in a batch, at most
+    static const int BatchSize = 1000;
+    // characters of a line shown around a match
+    static const int PreviewLength = 200;
+    // bytes decoded (and searched) at a time
+    static const int ChunkSize = 4 * 1024 * 1024;
+    // bytes looked at to guess the codec and to tell binaries
+    static const int SampleSize = 64 * 1024;
+
+Q_SIGNALS:
+    void resultsFound(const QVector<SearchResult>& results);
+
+    // files is the number of files searched; truncated is true
+    // when the search stopped at MaxResults
+    void finished(int files, bool truncated);
+
+private:
+    friend class DirectorySearchTask;
+
+    // what a search is looking for, shared by its tasks
+    struct Job {
+        int generation;
+        QString pattern;
+        Qt::CaseSensitivity cs;
+        QVector<QRegularExpression> includes;
+        QVector<QRegularExpression> excludes;
+
+        QAtomicInt pendingTasks;
+        QAtomicInt results;
+        QAtomicInt files;
+    };
+
+    // all thread safe, called by the tasks
+    bool isCancelled(int generation) const;
+    void queue(const QSharedPointer<Job>& job, const QString& directory);
+    void post(int generation, const QVector<SearchResult>& results);
+    void taskFinished(const QSharedPointer<Job>& job);
+
+    QThreadPool _pool;
+
+    // a new search (or a cancel) makes the running tasks stale
+    QAtomicInt _generation;
+    bool _running;
+};
+
+
+#endif // FILESEARCH_H
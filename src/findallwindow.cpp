@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "findallwindow.h"
+
+#include "application.h"
+#include "documentsearch.h"
+#include "mainwindow.h"
+
+#include <QCheckBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListView>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+
+FindAllWindow::FindAllWindow(QWidget *parent)
+    : QWidget(parent, Qt::Window)
+    , _findLineEdit( new QLineEdit(this) )
+    , _caseCheckBox( new QCheckBox( tr("Match Case") , this) )
+    , _resultsView( new QListView(this) )
+    , _statusLabel( new QLabel(this) )
+    , _results( new SearchResultsModel(this) )
+    , _search( new DocumentSearch(this) )
+{
+    setWindowTitle( tr("Find in All Documents") );
+    resize(800, 500);
+
+    auto label = new QLabel( tr("Search for:"), this);
+
+    auto findButton = new QPushButton( tr("Find"), this);
+    connect(findButton, &QPushButton::clicked, this, &FindAllWindow::find);
+    connect(_findLineEdit, &QLineEdit::returnPressed, this, &FindAllWindow::find);
+
+    // all rows have the same height: just the visible ones are laid out
+    _resultsView->setModel(_results);
+    _resultsView->setUniformItemSizes(true);
+    _resultsView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    connect(_resultsView, &QListView::activated, this, &FindAllWindow::showResult);
+    connect(_resultsView, &QListView::clicked, this, &FindAllWindow::showResult);
+
+    connect(_search, &DocumentSearch::resultsFound, _results, &SearchResultsModel::append);
+    connect(_search, &DocumentSearch::finished, this, &FindAllWindow::searchFinished);
+
+    // The UI
+    auto findLayout = new QHBoxLayout;
+    findLayout->addWidget(label);
+    findLayout->addWidget(_findLineEdit);
+    findLayout->addWidget(findButton);
+    findLayout->addWidget(_caseCheckBox);
+
+    auto layout = new QVBoxLayout;
+    layout->addLayout(findLayout);
+    layout->addWidget(_resultsView);
+    layout->addWidget(_statusLabel);
+    setLayout(layout);
+
+    setFocusProxy(_findLineEdit);
+}
+
+
+void FindAllWindow::setText(const QString& text)
+{
+    _findLineEdit->setText(text);
+    _findLineEdit->selectAll();
+}
+
+
+void FindAllWindow::find()
+{
+    _search->cancel();
+    _results->clear();
+    _documents.clear();
+
+    const QString text = _findLineEdit->text();
+    if (text.isEmpty()) {
+        _statusLabel->clear();
+        return;
+    }
+
+    // snapshots are shared: taking them costs nothing, when the
+    // documents have not been edited since the last one
+    QStringList sources;
+    QStringList texts;
+    const QList<MainWindow*> windows = Application::instance()->windows();
+    for (MainWindow* window : windows) {
+        const QString snapshot = window->documentSnapshot();
+        if (snapshot.isEmpty()) {
+            continue;
+        }
+        _documents.append(window);
+        sources << window->documentName();
+        texts << snapshot;
+    }
+
+    _statusLabel->setText( tr("Searching...") );
+    _search->start(sources, texts, text, _caseCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive);
+}
+
+
+void FindAllWindow::searchFinished(bool truncated)
+{
+    QString status = tr("%n match(es)", "", _results->rowCount());
+    if (truncated) {
+        status += QLatin1String(" - ") + tr("too many matches, the search has been stopped");
+    }
+    _statusLabel->setText(status);
+}
+
+
+void FindAllWindow::showResult(const QModelIndex& index)
+{
+    if (!index.isValid()) {
+        return;
+    }
+
+    const SearchResult& result = _results->result(index.row());
+    MainWindow* window = _documents.value(result.document);
+    if (!window) {
+        _statusLabel->setText( tr("the window has been closed") );
+        return;
+    }
+    window->showMatch(result.position, result.length);
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef FINDALLWINDOW_H
+#define FINDALLWINDOW_H
+
+
+#include <QList>
+#include <QPointer>
+#include <QWidget>
+
+#include "searchresultsmodel.h"
+
+class DocumentSearch;
+class MainWindow;
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QListView;
+class QModelIndex;
+
+
+// Finds a text in the documents of all the open windows: their
+// snapshots are searched in parallel and the results shared in a list.
+// Activating a result shows the match in its window.
+class FindAllWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FindAllWindow(QWidget *parent = nullptr);
+
+    void setText(const QString& text);
+
+private Q_SLOTS:
+    void find();
+    void searchFinished(bool truncated);
+    void showResult(const QModelIndex& index);
+
+private:
+    QLineEdit* _findLineEdit;
+    QCheckBox* _caseCheckBox;
+    QListView* _resultsView;
+    QLabel* _statusLabel;
+
+    SearchResultsModel* _results;
+    DocumentSearch* _search;
+
+    // the windows searched, by document index
+    QList<QPointer<MainWindow> > _documents;
+};
+
+
+#endif // FINDALLWINDOW_H
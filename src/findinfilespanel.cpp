@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "findinfilespanel.h"
+
+#include "filesearch.h"
+#include "searchresultsmodel.h"
+
+#include <QCheckBox>
+#include <QFileDialog>
+#include <QGridLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListView>
+#include <QPushButton>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QVBoxLayout>
+
+
+static QStringList globs(const QString& text)
+{
+    return text.split(QRegularExpression( QStringLiteral("[\\s,;]+") ), Qt::SkipEmptyParts);
+}
+
+
+FindInFilesPanel::FindInFilesPanel(QWidget *parent)
+    : QWidget(parent)
+    , _findLineEdit( new QLineEdit(this) )
+    , _directoryLineEdit( new QLineEdit(this) )
+    , _includeLineEdit( new QLineEdit(this) )
+    , _excludeLineEdit( new QLineEdit(this) )
+    , _caseCheckBox( new QCheckBox( tr("Match Case") , this) )
+    , _findButton( new QPushButton( tr("Find"), this) )
+    , _resultsView( new QListView(this) )
+    , _statusLabel( new QLabel(this) )
+    , _results( new SearchResultsModel(this) )
+    , _search( new FileSearch(this) )
+{
+    QSettings s;
+    _directoryLineEdit->setText( s.value( QStringLiteral("findInFiles/directory") ).toString() );
+    _includeLineEdit->setText( s.value( QStringLiteral("findInFiles/include") ).toString() );
+    _excludeLineEdit->setText( s.value( QStringLiteral("findInFiles/exclude"), QStringLiteral(".git .svn") ).toString() );
+
+    _includeLineEdit->setPlaceholderText( tr("all the files, or e.g. *.cpp *.h") );
+    _excludeLineEdit->setPlaceholderText( tr("e.g. .git build *.log") );
+
+    auto browseButton = new QPushButton( tr("Browse..."), this);
+    connect(browseButton, &QPushButton::clicked, this, &FindInFilesPanel::chooseDirectory);
+
+    connect(_findButton, &QPushButton::clicked, this, &FindInFilesPanel::findOrStop);
+    connect(_findLineEdit, &QLineEdit::returnPressed, this, &FindInFilesPanel::findOrStop);
+
+    // all rows have the same height: just the visible ones are laid out
+    _resultsView->setModel(_results);
+    _resultsView->setUniformItemSizes(true);
+    _resultsView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    // not on clicked too: a file must not be opened twice
+    connect(_resultsView, &QListView::activated, this, &FindInFilesPanel::showResult);
+
+    connect(_search, &FileSearch::resultsFound, _results, &SearchResultsModel::append);
+    connect(_search, &FileSearch::finished, this, &FindInFilesPanel::searchFinished);
+
+    // The UI
+    auto grid = new QGridLayout;
+    grid->addWidget(new QLabel( tr("Search for:"), this), 0, 0);
+    grid->addWidget(_findLineEdit, 0, 1);
+    grid->addWidget(_findButton, 0, 2);
+    grid->addWidget(_caseCheckBox, 0, 3);
+    grid->addWidget(new QLabel( tr("In folder:"), this), 1, 0);
+    grid->addWidget(_directoryLineEdit, 1, 1);
+    grid->addWidget(browseButton, 1, 2);
+    grid->addWidget(new QLabel( tr("Include:"), this), 2, 0);
+    grid->addWidget(_includeLineEdit, 2, 1);
+    grid->addWidget(new QLabel( tr("Exclude:"), this), 3, 0);
+    grid->addWidget(_excludeLineEdit, 3, 1);
+
+    auto layout = new QVBoxLayout;
+    layout->addLayout(grid);
+    layout->addWidget(_resultsView);
+    layout->addWidget(_statusLabel);
+    setLayout(layout);
+
+    setFocusProxy(_findLineEdit);
+}
+
+
+void FindInFilesPanel::setText(const QString& text)
+{
+    _findLineEdit->setText(text);
+    _findLineEdit->selectAll();
+}
+
+
+void FindInFilesPanel::setDefaultDirectory(const QString& directory)
+{
+    if (_directoryLineEdit->text().isEmpty()) {
+        _directoryLineEdit->setText(directory);
+    }
+}
+
+
+void FindInFilesPanel::findOrStop()
+{
+    if (_search->isRunning()) {
+        _search->cancel();
+        _findButton->setText( tr("Find") );
+        _statusLabel->setText( tr("Stopped: %n match(es)", "", _results->rowCount()) );
+        return;
+    }
+
+    _results->clear();
+
+    const QString text = _findLineEdit->text();
+    const QString directory = _directoryLineEdit->text();
+    if (text.isEmpty() || directory.isEmpty()) {
+        _statusLabel->clear();
+        return;
+    }
+
+    QSettings s;
+    s.setValue( QStringLiteral("findInFiles/directory"), directory);
+    s.setValue( QStringLiteral("findInFiles/include"), _includeLineEdit->text());
+    s.setValue( QStringLiteral("findInFiles/exclude"), _excludeLineEdit->text());
+
+    _findButton->setText( tr("Stop") );
+    _statusLabel->setText( tr("Searching...") );
+    _search->start(directory, text, _caseCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive,
+                   globs(_includeLineEdit->text()), globs(_excludeLineEdit->text()));
+}
+
+
+void FindInFilesPanel::chooseDirectory()
+{
+    const QString directory = QFileDialog::getExistingDirectory(this, tr("Find in Files"), _directoryLineEdit->text());
+    if (!directory.isEmpty()) {
+        _directoryLineEdit->setText(directory);
+    }
+}
+
+
+void FindInFilesPanel::searchFinished(int files, bool truncated)
+{
+    _findButton->setText( tr("Find") );
+
+    QString status = tr("%n match(es)", "", _results->rowCount()) + QLatin1String(", ") + tr("%n file(s) searched", "", files);
+    if (truncated) {
+        status += QLatin1String(" - ") + tr("too many matches, the search has been stopped");
+    }
+    _statusLabel->setText(status);
+}
+
+
+void FindInFilesPanel::showResult(const QModelIndex& index)
+{
+    if (index.isValid()) {
+        const SearchResult& result = _results->result(index.row());
+        Q_EMIT resultActivated(result.source, result.line);
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef FINDINFILESPANEL_H
+#define FINDINFILESPANEL_H
+
+
+#include <QWidget>
+
+class FileSearch;
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QListView;
+class QModelIndex;
+class QPushButton;
+class SearchResultsModel;
+
+
+// Finds a text in the files of a directory tree (see FileSearch),
+// listing the matches while they are found.
+class FindInFilesPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FindInFilesPanel(QWidget *parent = nullptr);
+
+    void setText(const QString& text);
+
+    // the directory searched when none has been chosen yet
+    void setDefaultDirectory(const QString& directory);
+
+Q_SIGNALS:
+    // line is 0 based
+    void resultActivated(const QString& path, int line);
+
+private Q_SLOTS:
+    void findOrStop();
+    void chooseDirectory();
+    void searchFinished(int files, bool truncated);
+    void showResult(const QModelIndex& index);
+
+private:
+    QLineEdit* _findLineEdit;
+    QLineEdit* _directoryLineEdit;
+    QLineEdit* _includeLineEdit;
+    QLineEdit* _excludeLineEdit;
+    QCheckBox* _caseCheckBox;
+    QPushButton* _findButton;
+    QListView* _resultsView;
+    QLabel* _statusLabel;
+
+    SearchResultsModel* _results;
+    FileSearch* _search;
+};
+
+
+#endif // FINDINFILESPANEL_H
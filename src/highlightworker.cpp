@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "highlightworker.h"
+
+#include <KSyntaxHighlighting/Format>
+
+
+HighlightWorker::HighlightWorker(int checkpointInterval, QObject *parent)
+    : QObject(parent)
+    , _checkpointInterval(checkpointInterval)
+    , _latestJob(0)
+    , _collecting(false)
+{
+}
+
+
+void HighlightWorker::supersede(int id)
+{
+    _latestJob.storeRelease(id);
+}
+
+
+void HighlightWorker::highlight(const HighlightJob& job)
+{
+    // superseded while waiting in the queue
+    if (job.id != _latestJob.loadAcquire()) {
+        return;
+    }
+
+    if (job.definition != definition() || job.theme.name() != theme().name()) {
+        setDefinition(job.definition);
+        setTheme(job.theme);
+        _charFormats.clear();
+    }
+
+    HighlightResult result;
+    result.generation = job.generation;
+    result.firstLine = job.firstLine;
+    result.formatsFrom = job.formatsFrom;
+
+    KSyntaxHighlighting::State state = job.state;
+    for (int i = 0; i < job.lines.size(); ++i) {
+        if (job.id != _latestJob.loadAcquire()) {
+            break;
+        }
+
+        const int line = job.firstLine + i;
+        _collecting = (line >= job.formatsFrom);
+        _ranges.clear();
+
+        state = highlightLine(job.lines.at(i), state);
+
+        if (_collecting) {
+            result.formats.append(_ranges);
+        }
+        if ((line + 1) % _checkpointInterval == 0) {
+            result.checkpoints.append(state);
+        }
+    }
+    _collecting = false;
+
+    Q_EMIT highlighted(result);
+}
+
+
+void HighlightWorker::applyFormat(int offset, int length, const KSyntaxHighlighting::Format &format)
+{
+    if (!_collecting || length == 0 || format.isDefaultTextStyle(theme())) {
+        return;
+    }
+
+    QHash<quint16, QTextCharFormat>::const_iterator it = _charFormats.constFind(format.id());
+    if (it == _charFormats.constEnd()) {
+        QTextCharFormat charFormat;
+        if (format.hasTextColor(theme())) {
+            charFormat.setForeground(format.textColor(theme()));
+        }
+        if (format.hasBackgroundColor(theme())) {
+            charFormat.setBackground(format.backgroundColor(theme()));
+        }
+        if (format.isBold(theme())) {
+            charFormat.setFontWeight(QFont::Bold);
+        }
+        if (format.isItalic(theme())) {
+            charFormat.setFontItalic(true);
+        }
+        if (format.isUnderline(theme())) {
+            charFormat.setFontUnderline(true);
+        }
+        if (format.isStrikeThrough(theme())) {
+            charFormat.setFontStrikeOut(true);
+        }
+        it = _charFormats.insert(format.id(), charFormat);
+    }
+
+    QTextLayout::FormatRange range;
+    range.start = offset;
+    range.length = length;
+    range.format = it.value();
+    _ranges.append(range);
+}
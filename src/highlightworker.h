@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef HIGHLIGHTWORKER_H
+#define HIGHLIGHTWORKER_H
+
+
+#include <KSyntaxHighlighting/AbstractHighlighter>
+#include <KSyntaxHighlighting/Definition>
+#include <KSyntaxHighlighting/State>
+#include <KSyntaxHighlighting/Theme>
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QMetaType>
+#include <QObject>
+#include <QStringList>
+#include <QTextCharFormat>
+#include <QTextLayout>
+#include <QVector>
+
+
+// lines to highlight, starting from a checkpoint
+struct HighlightJob {
+    int id;
+    // the document edits so far: results of older generations are stale
+    int generation;
+
+    KSyntaxHighlighting::Definition definition;
+    KSyntaxHighlighting::Theme theme;
+
+    // the snapshot of the lines from firstLine, and the state before it
+    int firstLine;
+    KSyntaxHighlighting::State state;
+    QStringList lines;
+
+    // just the states are computed for the lines before
+    int formatsFrom;
+};
+
+// what has been computed of a job (all of it, if not superseded)
+struct HighlightResult {
+    int generation;
+
+    // the states before the lines multiple of the checkpoint interval,
+    // after firstLine
+    int firstLine;
+    QVector<KSyntaxHighlighting::State> checkpoints;
+
+    // the formats of the lines from formatsFrom
+    int formatsFrom;
+    QVector<QVector<QTextLayout::FormatRange> > formats;
+};
+
+Q_DECLARE_METATYPE(HighlightResult)
+
+
+// Runs the syntax highlighter over a snapshot of the document lines,
+// in a worker thread: typing never waits for the highlighting states
+// to propagate. A new job supersedes the running one, which hands over
+// what it has computed so far.
+class HighlightWorker : public QObject, public KSyntaxHighlighting::AbstractHighlighter
+{
+    Q_OBJECT
+
+public:
+    explicit HighlightWorker(int checkpointInterval, QObject *parent = nullptr);
+
+    // thread safe, called from the GUI thread before queueing job id
+    void supersede(int id);
+
+public Q_SLOTS:
+    void highlight(const HighlightJob& job);
+
+Q_SIGNALS:
+    void highlighted(const HighlightResult& result);
+
+protected:
+    void applyFormat(int offset, int length, const KSyntaxHighlighting::Format &format) override;
+
+private:
+    int _checkpointInterval;
+    QAtomicInt _latestJob;
+
+    // format id -> its QTextCharFormat for the current theme
+    QHash<quint16, QTextCharFormat> _charFormats;
+
+    // the formats of the line being highlighted, when collecting
+    QVector<QTextLayout::FormatRange> _ranges;
+    bool _collecting;
+};
+
+#endif // HIGHLIGHTWORKER_H
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "incrementalsearch.h"
+
+#include <algorithm>
+
+
+IncrementalSearch::IncrementalSearch()
+    : _cs(Qt::CaseSensitive)
+{
+}
+
+
+qint64 IncrementalSearch::find(const QString& text, const QString& pattern, Qt::CaseSensitivity cs, qint64 from, bool* restarted)
+{
+    *restarted = false;
+    if (pattern.isEmpty()) {
+        return -1;
+    }
+
+    // an edit makes a new snapshot: the matches we have are gone
+    if (text.constData() != _text.constData() || cs != _cs) {
+        _text = text;
+        _cs = cs;
+        _prefixes.clear();
+    }
+
+    while (!_prefixes.isEmpty() && !pattern.startsWith(_prefixes.last().pattern)) {
+        _prefixes.removeLast();
+    }
+
+    if (_prefixes.isEmpty() || _prefixes.last().pattern != pattern) {
+        if (!addPrefix(pattern)) {
+            // too many matches to keep: the engine is quick enough with them
+            const ushort* data = _text.utf16();
+            qint64 position = _engine.indexIn(data, _text.size(), from);
+            if (position < 0 && from > 0) {
+                position = _engine.indexIn(data, _text.size(), 0);
+                *restarted = (position >= 0);
+            }
+            return position;
+        }
+    }
+
+    const QVector<int>& matches = _prefixes.last().matches;
+    QVector<int>::const_iterator it = std::lower_bound(matches.constBegin(), matches.constEnd(), from);
+    if (it != matches.constEnd()) {
+        return *it;
+    }
+    if (matches.isEmpty()) {
+        return -1;
+    }
+    *restarted = true;
+    return matches.first();
+}
+
+
+bool IncrementalSearch::addPrefix(const QString& pattern)
+{
+    _engine.setPattern(pattern, _cs);
+
+    const ushort* data = _text.utf16();
+    const qint64 size = _text.size();
+
+    QVector<int> matches;
+    if (!_prefixes.isEmpty()) {
+        // just where the shorter pattern matches the longer one can
+        const QVector<int>& candidates = _prefixes.last().matches;
+        for (int position : candidates) {
+            if (_engine.isMatchAt(data, size, position)) {
+                matches.append(position);
+            }
+        }
+    } else {
+        // overlapping matches too: they can be narrowed to different ones
+        qint64 position = _engine.indexIn(data, size, 0);
+        while (position >= 0) {
+            if (matches.size() == MaxCachedMatches) {
+                return false;
+            }
+            matches.append(int(position));
+            position = _engine.indexIn(data, size, position + 1);
+        }
+    }
+
+    Prefix prefix = { pattern, matches };
+    _prefixes.append(prefix);
+    return true;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef INCREMENTALSEARCH_H
+#define INCREMENTALSEARCH_H
+
+
+#include <QString>
+#include <QVector>
+
+#include "searchengine.h"
+
+
+// Find as you type. The matches of every prefix typed so far are kept:
+// the matches of a longer pattern are narrowed from the ones of its
+// prefix, instead of searching the whole text again, and deleting
+// characters goes back to the matches of a shorter prefix.
+class IncrementalSearch
+{
+public:
+    IncrementalSearch();
+
+    // the first match of pattern in text at or after from, else the first
+    // one in text (restarted is set then). -1 when there is none at all
+    qint64 find(const QString& text, const QString& pattern, Qt::CaseSensitivity cs, qint64 from, bool* restarted);
+
+    // prefixes with more matches are not kept, but searched directly
+    static const int MaxCachedMatches = 1024 * 1024;
+
+private:
+    struct Prefix {
+        QString pattern;
+        QVector<int> matches;
+    };
+
+    bool addPrefix(const QString& pattern);
+
+    QString _text;
+    Qt::CaseSensitivity _cs;
+
+    // the prefixes of the last pattern, shortest first
+    QVector<Prefix> _prefixes;
+
+    SearchEngine _engine;
+};
+
+
+#endif // INCREMENTALSEARCH_H
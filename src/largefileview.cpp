@@ -0,0 +1,986 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "largefileview.h"
+
+#include "textcodec.h"
+
+#include <QFile>
+#include <QKeyEvent>
+#include <QMessageBox>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextCodec>
+#include <QThread>
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+
+// bytes decoded at once when searching
+static const qint64 SearchWindow = 4 * 1024 * 1024;
+
+// bytes scanned by the indexer before publishing its results
+static const qint64 IndexBatch = 16 * 1024 * 1024;
+
+// very long lines are painted truncated
+static const qint64 MaxLineBytes = 64 * 1024;
+
+static const int TextFlags = Qt::AlignLeft | Qt::AlignTop | Qt::TextSingleLine | Qt::TextExpandTabs;
+
+
+static int countNewlines(const QString & text, int from, int to)
+{
+    int count = 0;
+    const QChar* data = text.constData();
+    for (int i = from; i < to; ++i) {
+        if (data[i] == QLatin1Char('\n')) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+
+LargeFileView::LargeFileView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+    , _file(nullptr)
+    , _headerSize(0)
+    , _textCodec( QTextCodec::codecForLocale() )
+    , _indexerThread(nullptr)
+    , _indexer(nullptr)
+    , _indexed(false)
+    , _saverThread(nullptr)
+    , _saver(nullptr)
+    , _modified(false)
+    , _restoreLine(-1)
+    , _cursorLine(0)
+    , _cursorColumn(0)
+    , _matchLine(-1)
+    , _matchColumn(0)
+    , _matchLength(0)
+    , _maxLineWidth(0)
+    , _offsetsLine(-1)
+{
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setCursor(Qt::IBeamCursor);
+}
+
+
+LargeFileView::~LargeFileView()
+{
+    closeFile();
+}
+
+
+bool LargeFileView::openFile(const QString & path)
+{
+    closeFile();
+
+    _file = new QFile(path);
+    if (!_file->open(QIODevice::ReadOnly)) {
+        qDebug() << "cannot open" << path;
+        closeFile();
+        return false;
+    }
+
+    const qint64 size = _file->size();
+    const char* data = reinterpret_cast<const char*>(_file->map(0, size));
+    if (!data) {
+        qDebug() << "cannot map" << path;
+        closeFile();
+        return false;
+    }
+
+    QByteArray head = QByteArray::fromRawData(data, int(qMin<qint64>(size, 64 * 1024)));
+    _textCodec = TextCodec::codecForByteArray(head);
+
+    // lines are split on '\n' bytes: that doesn't work with UTF-16 and UTF-32
+    const int mib = _textCodec->mibEnum();
+    if ((mib >= 1013 && mib <= 1015) || (mib >= 1017 && mib <= 1019)) {
+        qDebug() << "codec" << _textCodec->name() << "not supported by the large file viewer";
+        closeFile();
+        return false;
+    }
+
+    // the UTF-8 BOM is neither painted nor edited
+    if (mib == 106 && head.startsWith("\xEF\xBB\xBF")) {
+        _headerSize = 3;
+    }
+
+    _pieces.setOriginal(data, size);
+
+    _indexerThread = new QThread;
+    _indexer = new LineIndexer(data, size);
+    _indexer->moveToThread(_indexerThread);
+
+    connect(_indexerThread, &QThread::started, _indexer, &LineIndexer::index);
+    connect(_indexer, &LineIndexer::checkpointsFound, this, &LargeFileView::addCheckpoints);
+    connect(_indexer, &LineIndexer::progress, this, &LargeFileView::indexProgress);
+    connect(_indexer, &LineIndexer::finished, this, &LargeFileView::indexingFinished);
+
+    _indexerThread->start();
+
+    setCursorPosition(0, 0);
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+    updateScrollBars();
+    viewport()->update();
+    return true;
+}
+
+
+void LargeFileView::closeFile()
+{
+    stopIndexer();
+    waitForSaver();
+
+    _pieces.clear();
+    _headerSize = 0;
+    _indexed = false;
+    _restoreLine = -1;
+
+    if (_modified) {
+        _modified = false;
+        Q_EMIT modificationChanged(false);
+    }
+    Q_EMIT undoAvailable(false);
+    Q_EMIT redoAvailable(false);
+
+    // this unmaps the file, too
+    delete _file;
+    _file = nullptr;
+
+    _cursorLine = 0;
+    _cursorColumn = 0;
+    _matchLine = -1;
+    _maxLineWidth = 0;
+    _offsetsLine = -1;
+}
+
+
+bool LargeFileView::isReadOnly() const
+{
+    return !_indexed || isSaving();
+}
+
+
+bool LargeFileView::saveFile(const QString & path)
+{
+    if (!_file || isIndexing() || isSaving()) {
+        return false;
+    }
+
+    _savingPath = path;
+
+    // the saver writes a snapshot of the pieces: the mapping
+    // stays alive until it has finished (see closeFile())
+    _saverThread = new QThread;
+    _saver = new FileSaver(path, _pieces);
+    _saver->moveToThread(_saverThread);
+
+    connect(_saverThread, &QThread::started, _saver, &FileSaver::save);
+    connect(_saver, &FileSaver::progress, this, &LargeFileView::saveProgress);
+    connect(_saver, &FileSaver::finished, this, &LargeFileView::savingFinished);
+
+    _saverThread->start();
+    viewport()->update();
+    return true;
+}
+
+
+QTextCodec* LargeFileView::textCodec()
+{
+    return _textCodec;
+}
+
+
+void LargeFileView::setTextCodec(QTextCodec* codec)
+{
+    _textCodec = codec;
+    _maxLineWidth = 0;
+    _offsetsLine = -1;
+    setCursorPosition(_cursorLine, _cursorColumn);
+    updateScrollBars();
+    viewport()->update();
+}
+
+
+int LargeFileView::lineCount()
+{
+    return _pieces.lineCount();
+}
+
+
+int LargeFileView::currentLine()
+{
+    return _cursorLine;
+}
+
+
+int LargeFileView::currentColumn()
+{
+    return _cursorColumn;
+}
+
+
+void LargeFileView::gotoLine(int line)
+{
+    setCursorPosition(line, 0);
+    _matchLine = -1;
+
+    // center it
+    int visibleLines = viewport()->height() / fontMetrics().height();
+    verticalScrollBar()->setValue(_cursorLine - visibleLines / 2);
+    viewport()->update();
+}
+
+
+void LargeFileView::moveCursorToStart()
+{
+    setCursorPosition(0, 0);
+}
+
+
+void LargeFileView::moveCursorToEnd()
+{
+    setCursorPosition(lineCount() - 1, lineText(lineCount() - 1).length());
+}
+
+
+bool LargeFileView::find(const QString & text, QTextDocument::FindFlags flags)
+{
+    if (!_file || text.isEmpty()) {
+        return false;
+    }
+
+    const Qt::CaseSensitivity cs = (flags & QTextDocument::FindCaseSensitively) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    const qint64 size = _pieces.size();
+
+    // the document is decoded one window (a bunch of whole lines) at a time:
+    // patterns cannot contain new lines, so no match is lost on a window boundary
+    if (!(flags & QTextDocument::FindBackward)) {
+        int line = _cursorLine;
+        int from = _cursorColumn;
+        qint64 start = textStart(line);
+
+        while (true) {
+            qint64 end = qMin(size, start + SearchWindow);
+            if (end < size) {
+                end = qMin(size, _pieces.lineEnd(end) + 1);
+            }
+
+            QString window = _textCodec->toUnicode(_pieces.bytes(start, end - start));
+            int pos = window.indexOf(text, from, cs);
+            if (pos >= 0) {
+                int lastNewline = pos > 0 ? window.lastIndexOf(QLatin1Char('\n'), pos - 1) : -1;
+                int matchLine = line + countNewlines(window, 0, pos);
+                int matchColumn = pos - lastNewline - 1;
+
+                _matchLine = matchLine;
+                _matchColumn = matchColumn;
+                _matchLength = text.length();
+                setCursorPosition(matchLine, matchColumn + text.length());
+                ensureCursorVisible();
+                return true;
+            }
+
+            if (end >= size) {
+                return false;
+            }
+            line += countNewlines(window, 0, window.length());
+            start = end;
+            from = 0;
+        }
+    }
+
+    qint64 end = _pieces.lineEnd(_pieces.lineStart(_cursorLine));
+    bool cursorWindow = true;
+
+    while (true) {
+        qint64 start = qMax<qint64>(0, end - SearchWindow);
+        start = qMax<qint64>(_headerSize, _pieces.lineStart(_pieces.lineForOffset(start)));
+
+        QString window = _textCodec->toUnicode(_pieces.bytes(start, end - start));
+
+        // a backward match has to START before the cursor, or before the
+        // match the cursor stands at the end of (as a selection would)
+        int from = window.length() - 1;
+        if (cursorWindow) {
+            int cursorLineStart = window.lastIndexOf(QLatin1Char('\n')) + 1;
+            int column = _cursorColumn;
+            if (_cursorLine == _matchLine && _cursorColumn == _matchColumn + _matchLength) {
+                column = _matchColumn;
+            }
+            from = cursorLineStart + column - 1;
+            cursorWindow = false;
+        }
+
+        if (from >= 0) {
+            int pos = window.lastIndexOf(text, from, cs);
+            if (pos >= 0) {
+                int lastNewline = pos > 0 ? window.lastIndexOf(QLatin1Char('\n'), pos - 1) : -1;
+                int matchLine = _pieces.lineForOffset(start) + countNewlines(window, 0, pos);
+                int matchColumn = pos - lastNewline - 1;
+
+                _matchLine = matchLine;
+                _matchColumn = matchColumn;
+                _matchLength = text.length();
+                setCursorPosition(matchLine, matchColumn);
+                ensureCursorVisible();
+                return true;
+            }
+        }
+
+        if (start <= _headerSize) {
+            return false;
+        }
+        end = start;
+    }
+}
+
+
+void LargeFileView::undo()
+{
+    if (isReadOnly()) {
+        return;
+    }
+
+    const qint64 offset = _pieces.undo();
+    if (offset >= 0) {
+        setCursorOffset(offset);
+        documentChanged();
+    }
+}
+
+
+void LargeFileView::redo()
+{
+    if (isReadOnly()) {
+        return;
+    }
+
+    const qint64 offset = _pieces.redo();
+    if (offset >= 0) {
+        setCursorOffset(offset);
+        documentChanged();
+    }
+}
+
+
+void LargeFileView::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), palette().base());
+
+    if (!_file) {
+        return;
+    }
+
+    const int lineHeight = fontMetrics().height();
+    const int firstLine = verticalScrollBar()->value();
+    const int visibleLines = viewport()->height() / lineHeight + 1;
+    const int lines = lineCount();
+    const int gutter = gutterWidth();
+    const int x = gutter + 3 - horizontalScrollBar()->value();
+
+    int maxLineWidth = _maxLineWidth;
+
+    for (int i = 0; i < visibleLines && firstLine + i < lines; ++i) {
+        const int line = firstLine + i;
+        const int y = i * lineHeight;
+        const QString text = lineText(line);
+
+        if (line == _cursorLine) {
+            painter.fillRect(0, y, viewport()->width(), lineHeight, palette().alternateBase());
+        }
+
+        if (line == _matchLine) {
+            int matchX = x + textWidth(text.left(_matchColumn));
+            int matchWidth = textWidth(text.mid(_matchColumn, _matchLength));
+            painter.fillRect(matchX, y, matchWidth, lineHeight, palette().highlight());
+        }
+
+        painter.setPen(palette().text().color());
+        int width = textWidth(text);
+        painter.drawText(QRect(x, y, width, lineHeight), TextFlags, text);
+
+        if (line == _cursorLine && !isReadOnly()) {
+            painter.fillRect(x + textWidth(text.left(_cursorColumn)), y, 1, lineHeight, palette().text());
+        }
+
+        maxLineWidth = qMax(maxLineWidth, width);
+    }
+
+    // line numbers, over the text
+    painter.fillRect(0, 0, gutter, viewport()->height(), Qt::lightGray);
+    painter.setPen(Qt::black);
+    for (int i = 0; i < visibleLines && firstLine + i < lines; ++i) {
+        painter.drawText(0, i * lineHeight, gutter, lineHeight, Qt::AlignRight, QString::number(firstLine + i + 1));
+    }
+
+    // the widest line painted so far drives the horizontal scroll bar
+    if (maxLineWidth > _maxLineWidth) {
+        _maxLineWidth = maxLineWidth;
+        updateScrollBars();
+    }
+}
+
+
+void LargeFileView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+
+void LargeFileView::keyPressEvent(QKeyEvent *event)
+{
+    if (!isReadOnly()) {
+        switch (event->key()) {
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            insertLineBreak();
+            event->accept();
+            return;
+        case Qt::Key_Backspace:
+            deleteCharacter(true);
+            event->accept();
+            return;
+        case Qt::Key_Delete:
+            deleteCharacter(false);
+            event->accept();
+            return;
+        default:
+            break;
+        }
+
+        const QString text = event->text();
+        const bool shortcut = event->modifiers() & (Qt::ControlModifier | Qt::AltModifier);
+        if (!shortcut && !text.isEmpty() && (text.at(0).isPrint() || text.at(0) == QLatin1Char('\t'))) {
+            insertText(text);
+            event->accept();
+            return;
+        }
+    }
+
+    const int pageLines = qMax(1, viewport()->height() / fontMetrics().height() - 1);
+    const bool ctrl = event->modifiers() & Qt::ControlModifier;
+
+    int line = _cursorLine;
+    int column = _cursorColumn;
+    switch (event->key()) {
+    case Qt::Key_Up:
+        line--;
+        break;
+    case Qt::Key_Down:
+        line++;
+        break;
+    case Qt::Key_PageUp:
+        line -= pageLines;
+        break;
+    case Qt::Key_PageDown:
+        line += pageLines;
+        break;
+    case Qt::Key_Left:
+        if (column > 0) {
+            column--;
+        } else if (line > 0) {
+            line--;
+            column = lineText(line).length();
+        }
+        break;
+    case Qt::Key_Right:
+        if (column < lineText(line).length()) {
+            column++;
+        } else if (line < lineCount() - 1) {
+            line++;
+            column = 0;
+        }
+        break;
+    case Qt::Key_Home:
+        line = ctrl ? 0 : line;
+        column = 0;
+        break;
+    case Qt::Key_End:
+        line = ctrl ? lineCount() - 1 : line;
+        column = lineText(line).length();
+        break;
+    default:
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+
+    setCursorPosition(line, column);
+    ensureCursorVisible();
+    event->accept();
+}
+
+
+void LargeFileView::mousePressEvent(QMouseEvent *event)
+{
+    int line = verticalScrollBar()->value() + event->pos().y() / fontMetrics().height();
+    line = qBound(0, line, lineCount() - 1);
+
+    const int x = event->pos().x() - gutterWidth() - 3 + horizontalScrollBar()->value();
+    setCursorPosition(line, columnAt(lineText(line), x));
+    event->accept();
+}
+
+
+void LargeFileView::addCheckpoints(const QVector<qint64>& checkpoints, int lineCount)
+{
+    _pieces.addOriginalCheckpoints(checkpoints, lineCount);
+    updateScrollBars();
+    viewport()->update();
+}
+
+
+void LargeFileView::cancelIndexing()
+{
+    if (_indexer) {
+        finishIndexing();
+    }
+}
+
+
+void LargeFileView::indexingFinished()
+{
+    // the piece table can be edited just with a complete line index
+    _indexed = true;
+    finishIndexing();
+
+    if (_restoreLine >= 0) {
+        gotoLine(_restoreLine);
+        _restoreLine = -1;
+    }
+}
+
+
+void LargeFileView::finishIndexing()
+{
+    stopIndexer();
+    updateScrollBars();
+    viewport()->update();
+    Q_EMIT indexFinished();
+}
+
+
+void LargeFileView::savingFinished(FileSaver::Result result)
+{
+    // a stale signal, the file has been closed meanwhile
+    if (!_saver) {
+        return;
+    }
+
+    waitForSaver();
+
+    const bool saved = (result == FileSaver::Saved);
+    if (result == FileSaver::Failed) {
+        QMessageBox::critical(this, tr("Error"), tr("Cannot save file. Not writable") );
+    }
+
+    if (saved) {
+        // the saved file becomes the original buffer
+        const int line = _cursorLine;
+        QTextCodec* codec = _textCodec;
+
+        if (openFile(_savingPath)) {
+            _textCodec = codec;
+            _restoreLine = line;
+        } else {
+            qDebug() << "cannot reopen" << _savingPath;
+        }
+    }
+
+    viewport()->update();
+    Q_EMIT saveFinished(saved);
+}
+
+
+void LargeFileView::stopIndexer()
+{
+    if (!_indexer) {
+        return;
+    }
+
+    _indexer->cancel();
+    _indexerThread->quit();
+    _indexerThread->wait();
+
+    delete _indexer;
+    delete _indexerThread;
+    _indexer = nullptr;
+    _indexerThread = nullptr;
+}
+
+
+void LargeFileView::waitForSaver()
+{
+    if (!_saver) {
+        return;
+    }
+
+    // the saver is not cancelled: a started save always completes
+    _saverThread->quit();
+    _saverThread->wait();
+
+    delete _saver;
+    delete _saverThread;
+    _saver = nullptr;
+    _saverThread = nullptr;
+}
+
+
+qint64 LargeFileView::textStart(int line)
+{
+    return line == 0 ? _headerSize : _pieces.lineStart(line);
+}
+
+
+QString LargeFileView::lineText(int line)
+{
+    const qint64 start = textStart(line);
+    qint64 end = _pieces.lineEnd(start);
+    const QByteArray bytes = _pieces.bytes(start, qMin(end - start, MaxLineBytes));
+    if (end - start <= MaxLineBytes && bytes.endsWith('\r')) {
+        return _textCodec->toUnicode(bytes.constData(), bytes.size() - 1);
+    }
+    return _textCodec->toUnicode(bytes);
+}
+
+
+bool LargeFileView::isTruncated(int line)
+{
+    const qint64 start = textStart(line);
+    return _pieces.lineEnd(start) - start > MaxLineBytes;
+}
+
+
+QByteArray LargeFileView::encode(const QString & text)
+{
+    QTextCodec::ConverterState state(QTextCodec::IgnoreHeader);
+    return _textCodec->fromUnicode(text.constData(), text.length(), &state);
+}
+
+
+int LargeFileView::textWidth(const QString & text)
+{
+    return fontMetrics().size(TextFlags, text).width();
+}
+
+
+int LargeFileView::columnAt(const QString & text, int x)
+{
+    if (x <= 0) {
+        return 0;
+    }
+    if (textWidth(text) < x) {
+        return text.length();
+    }
+
+    // binary search of the first column at or past x (the widths only
+    // grow with the column), then the nearest character boundary
+    int low = 1;
+    int high = text.length();
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        if (textWidth(text.left(middle)) >= x) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+
+    const int width = textWidth(text.left(low));
+    const int previous = textWidth(text.left(low - 1));
+    return (x - previous < width - x) ? low - 1 : low;
+}
+
+
+qint64 LargeFileView::columnOffset(int line, int column)
+{
+    if (line != _offsetsLine) {
+        _offsetsLine = line;
+        _columnOffsets.clear();
+
+        const qint64 start = textStart(line);
+        QByteArray bytes = _pieces.bytes(start, qMin(_pieces.lineEnd(start) - start, MaxLineBytes));
+        if (bytes.endsWith('\r')) {
+            bytes.chop(1);
+        }
+
+        // re-encoding the decoded text does not give the bytes back when
+        // they are not valid (they decode to U+FFFD): the decoder itself,
+        // fed a byte at a time, tells where the bytes of each column start
+        QTextCodec::ConverterState state(QTextCodec::IgnoreHeader);
+        int pending = 0;
+        for (int i = 0; i < bytes.size(); ++i) {
+            const QString decoded = _textCodec->toUnicode(bytes.constData() + i, 1, &state);
+            for (int j = 0; j < decoded.length(); ++j) {
+                // a sequence cut by byte i, then the character starting there
+                if (j > 0 && !decoded.at(j).isLowSurrogate() && pending < i) {
+                    pending = i;
+                }
+                _columnOffsets.append(pending);
+            }
+            if (!decoded.isEmpty()) {
+                pending = i + 1;
+            }
+        }
+        // a sequence cut by the line end is one more (invalid) character
+        if (pending < bytes.size()) {
+            _columnOffsets.append(pending);
+        }
+        _columnOffsets.append(bytes.size());
+    }
+
+    return _columnOffsets.at(qBound(0, column, _columnOffsets.size() - 1));
+}
+
+
+qint64 LargeFileView::cursorOffset()
+{
+    return textStart(_cursorLine) + columnOffset(_cursorLine, _cursorColumn);
+}
+
+
+void LargeFileView::setCursorOffset(qint64 offset)
+{
+    const int line = _pieces.lineForOffset(offset);
+    const qint64 start = textStart(line);
+    if (isTruncated(line)) {
+        setCursorPosition(line, _textCodec->toUnicode(_pieces.bytes(start, qMax<qint64>(0, offset - start))).length());
+        return;
+    }
+
+    // the last column starting at (or before) offset. Undo and redo
+    // changed the document: the offsets are decoded again
+    _offsetsLine = -1;
+    columnOffset(line, 0);
+    const int column = int(std::upper_bound(_columnOffsets.constBegin(), _columnOffsets.constEnd(), offset - start)
+                           - _columnOffsets.constBegin()) - 1;
+    setCursorPosition(line, column);
+}
+
+
+void LargeFileView::insertText(const QString & text)
+{
+    if (isTruncated(_cursorLine)) {
+        return;
+    }
+
+    _pieces.insert(cursorOffset(), encode(text));
+    _cursorColumn += text.length();
+    documentChanged();
+}
+
+
+void LargeFileView::insertLineBreak()
+{
+    if (isTruncated(_cursorLine)) {
+        return;
+    }
+
+    // keep the line break style of the current line
+    const qint64 start = _pieces.lineStart(_cursorLine);
+    const qint64 end = _pieces.lineEnd(start);
+    const bool crlf = end > start && _pieces.bytes(end - 1, 1).at(0) == '\r';
+
+    _pieces.insert(cursorOffset(), encode(crlf ? QStringLiteral("\r\n") : QStringLiteral("\n")));
+    _cursorLine++;
+    _cursorColumn = 0;
+    documentChanged();
+}
+
+
+void LargeFileView::deleteCharacter(bool backward)
+{
+    // the column of a truncated line is not an offset in its bytes
+    if (isTruncated(_cursorLine)) {
+        return;
+    }
+
+    const QString text = lineText(_cursorLine);
+
+    if (backward ? _cursorColumn > 0 : _cursorColumn < text.length()) {
+        // never split a surrogate pair
+        int from = _cursorColumn;
+        int to = _cursorColumn;
+        if (backward) {
+            --from;
+            if (from > 0 && text.at(from).isLowSurrogate() && text.at(from - 1).isHighSurrogate()) {
+                --from;
+            }
+        } else {
+            ++to;
+            if (to < text.length() && text.at(to - 1).isHighSurrogate() && text.at(to).isLowSurrogate()) {
+                ++to;
+            }
+        }
+
+        const qint64 offset = columnOffset(_cursorLine, from);
+        _pieces.remove(textStart(_cursorLine) + offset, columnOffset(_cursorLine, to) - offset);
+        _cursorColumn = from;
+        documentChanged();
+        return;
+    }
+
+    // join two lines, removing the line break ('\n' or "\r\n")
+    const int line = backward ? _cursorLine - 1 : _cursorLine;
+    if (line < 0 || line >= lineCount() - 1 || isTruncated(line)) {
+        return;
+    }
+
+    const int column = lineText(line).length();
+    const qint64 start = _pieces.lineStart(line);
+    const qint64 end = _pieces.lineEnd(start);
+    const qint64 breakStart = (end > start && _pieces.bytes(end - 1, 1).at(0) == '\r') ? end - 1 : end;
+
+    _pieces.remove(breakStart, end + 1 - breakStart);
+    _cursorLine = line;
+    _cursorColumn = column;
+    documentChanged();
+}
+
+
+void LargeFileView::documentChanged()
+{
+    _matchLine = -1;
+    _offsetsLine = -1;
+
+    // undoing every edit still leaves the document modified:
+    // the history is bounded, it may not reach the saved state
+    if (!_modified) {
+        _modified = true;
+        Q_EMIT modificationChanged(true);
+    }
+    Q_EMIT undoAvailable(_pieces.isUndoAvailable());
+    Q_EMIT redoAvailable(_pieces.isRedoAvailable());
+
+    updateScrollBars();
+    ensureCursorVisible();
+    viewport()->update();
+    Q_EMIT cursorPositionChanged();
+}
+
+
+void LargeFileView::setCursorPosition(int line, int column)
+{
+    _cursorLine = qBound(0, line, qMax(0, lineCount() - 1));
+    _cursorColumn = qBound(0, column, lineText(_cursorLine).length());
+    viewport()->update();
+    Q_EMIT cursorPositionChanged();
+}
+
+
+void LargeFileView::ensureCursorVisible()
+{
+    const int firstLine = verticalScrollBar()->value();
+    const int visibleLines = qMax(1, viewport()->height() / fontMetrics().height());
+
+    if (_cursorLine < firstLine) {
+        verticalScrollBar()->setValue(_cursorLine);
+    } else if (_cursorLine >= firstLine + visibleLines) {
+        verticalScrollBar()->setValue(_cursorLine - visibleLines + 1);
+    }
+
+    const int cursorX = textWidth(lineText(_cursorLine).left(_cursorColumn));
+    const int visibleWidth = viewport()->width() - gutterWidth() - 3;
+
+    if (cursorX < horizontalScrollBar()->value()) {
+        horizontalScrollBar()->setValue(cursorX);
+    } else if (cursorX >= horizontalScrollBar()->value() + visibleWidth) {
+        _maxLineWidth = qMax(_maxLineWidth, cursorX + 1);
+        updateScrollBars();
+        horizontalScrollBar()->setValue(cursorX - visibleWidth + 1);
+    }
+}
+
+
+void LargeFileView::updateScrollBars()
+{
+    const int visibleLines = qMax(1, viewport()->height() / fontMetrics().height());
+    verticalScrollBar()->setRange(0, qMax(0, lineCount() - visibleLines));
+    verticalScrollBar()->setPageStep(visibleLines);
+    verticalScrollBar()->setSingleStep(1);
+
+    const int visibleWidth = viewport()->width() - gutterWidth();
+    horizontalScrollBar()->setRange(0, qMax(0, _maxLineWidth - visibleWidth));
+    horizontalScrollBar()->setPageStep(visibleWidth);
+    horizontalScrollBar()->setSingleStep(fontMetrics().horizontalAdvance(QLatin1Char('9')));
+}
+
+
+int LargeFileView::gutterWidth()
+{
+    int digits = 2;
+    int max = qMax(1, lineCount());
+    while (max >= 10) {
+        max /= 10;
+        ++digits;
+    }
+
+    return 3 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits;
+}
+
+
+// ------------------------------------------------------------------------------------
+
+
+LineIndexer::LineIndexer(const char* data, qint64 size, QObject *parent)
+    : QObject(parent)
+    , _data(data)
+    , _size(size)
+    , _cancelled(0)
+{
+}
+
+
+void LineIndexer::cancel()
+{
+    _cancelled.storeRelease(1);
+}
+
+
+void LineIndexer::index()
+{
+    QVector<qint64> checkpoints;
+    int lineCount = 1;
+    qint64 offset = 0;
+
+    while (offset < _size) {
+        if (_cancelled.loadAcquire()) {
+            return;
+        }
+
+        const qint64 batchEnd = qMin(_size, offset + IndexBatch);
+        while (offset < batchEnd) {
+            const char* nl = static_cast<const char*>(memchr(_data + offset, '\n', batchEnd - offset));
+            if (!nl) {
+                offset = batchEnd;
+                break;
+            }
+            offset = nl - _data + 1;
+            if (lineCount % PieceTable::LineStride == 0) {
+                checkpoints.append(offset);
+            }
+            ++lineCount;
+        }
+
+        Q_EMIT checkpointsFound(checkpoints, lineCount);
+        Q_EMIT progress(int(offset * 100 / _size));
+        checkpoints.clear();
+    }
+
+    Q_EMIT finished();
+}
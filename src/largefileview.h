@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef LARGEFILEVIEW_H
+#define LARGEFILEVIEW_H
+
+
+#include "filesaver.h"
+#include "piecetable.h"
+
+#include <QAbstractScrollArea>
+#include <QAtomicInt>
+#include <QTextDocument>
+#include <QVector>
+
+class LineIndexer;
+class QFile;
+class QTextCodec;
+class QThread;
+
+
+// Viewer and (plain) editor for (very) large files.
+// The file is memory mapped and never copied in the heap: a sparse
+// line index (an offset every LineStride lines) is built in a worker
+// thread and just the visible lines are decoded and painted.
+// Edits go to a PieceTable over the mapping, so they are allowed
+// once the whole file has been indexed (and never on the lines too long
+// to be decoded whole).
+class LargeFileView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit LargeFileView(QWidget *parent = nullptr);
+    ~LargeFileView();
+
+    // returns false if the file cannot be mapped or its encoding
+    // is not line friendly (e.g. UTF-16): use a TextEdit then
+    bool openFile(const QString & path);
+    void closeFile();
+
+    inline bool isIndexing() const { return _indexer != nullptr; };
+    inline bool isSaving() const { return _saver != nullptr; };
+
+    // while indexing (or if it has been cancelled) and saving
+    bool isReadOnly() const;
+    inline bool isModified() const { return _modified; };
+
+    // saves in a worker thread, then maps the saved file:
+    // the undo history does not survive a save
+    bool saveFile(const QString & path);
+
+    QTextCodec* textCodec();
+    void setTextCodec(QTextCodec* codec);
+
+    // lines indexed so far
+    int lineCount();
+
+    int currentLine();
+    int currentColumn();
+    void gotoLine(int line);
+
+    void moveCursorToStart();
+    void moveCursorToEnd();
+
+    // same semantic of QPlainTextEdit::find(), starting from the cursor
+    bool find(const QString & text, QTextDocument::FindFlags flags = QTextDocument::FindFlags());
+
+public Q_SLOTS:
+    // keeps the lines indexed so far, read only
+    void cancelIndexing();
+
+    void undo();
+    void redo();
+
+Q_SIGNALS:
+    void indexProgress(int percent);
+    void indexFinished();
+    void cursorPositionChanged();
+
+    void modificationChanged(bool changed);
+    void undoAvailable(bool available);
+    void redoAvailable(bool available);
+
+    void saveProgress(int percent);
+    void saveFinished(bool saved);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+
+private Q_SLOTS:
+    void addCheckpoints(const QVector<qint64>& checkpoints, int lineCount);
+    void indexingFinished();
+    void savingFinished(FileSaver::Result result);
+
+private:
+    void stopIndexer();
+    void finishIndexing();
+    void waitForSaver();
+
+    // offset of the first character of line (skipping the BOM)
+    qint64 textStart(int line);
+    QString lineText(int line);
+    bool isTruncated(int line);
+    QByteArray encode(const QString & text);
+
+    // the byte offset of column in line, from its text start
+    qint64 columnOffset(int line, int column);
+    int textWidth(const QString & text);
+    int columnAt(const QString & text, int x);
+
+    qint64 cursorOffset();
+    void setCursorOffset(qint64 offset);
+
+    void insertText(const QString & text);
+    void insertLineBreak();
+    void deleteCharacter(bool backward);
+    void documentChanged();
+
+    void setCursorPosition(int line, int column);
+    void ensureCursorVisible();
+    void updateScrollBars();
+    int gutterWidth();
+
+    QFile* _file;
+    PieceTable _pieces;
+    int _headerSize;
+
+    QTextCodec* _textCodec;
+
+    QThread* _indexerThread;
+    LineIndexer* _indexer;
+    bool _indexed;
+
+    QThread* _saverThread;
+    FileSaver* _saver;
+    QString _savingPath;
+    bool _modified;
+
+    // cursor line to restore once the saved file has been indexed
+    int _restoreLine;
+
+    int _cursorLine;
+    int _cursorColumn;
+
+    // last match found, painted as a selection
+    int _matchLine;
+    int _matchColumn;
+    int _matchLength;
+
+    int _maxLineWidth;
+
+    // where each column of a line starts in its bytes (plus the line end):
+    // the cursor line, decoded again just when the document changes
+    int _offsetsLine;
+    QVector<int> _columnOffsets;
+};
+
+
+// ------------------------------------------------------------------------------------
+
+
+class LineIndexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    LineIndexer(const char* data, qint64 size, QObject *parent = nullptr);
+
+    // thread safe
+    void cancel();
+
+public Q_SLOTS:
+    void index();
+
+Q_SIGNALS:
+    void checkpointsFound(const QVector<qint64>& checkpoints, int lineCount);
+    void progress(int percent);
+    void finished();
+
+private:
+    const char* _data;
+    qint64 _size;
+
+    QAtomicInt _cancelled;
+};
+
+
+#endif // LARGEFILEVIEW_H
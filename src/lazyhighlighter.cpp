@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "lazyhighlighter.h"
+
+#include <KSyntaxHighlighting/Format>
+
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QThread>
+#include <QTimer>
+
+
+// the user state of the blocks with highlighting formats
+static const int Formatted = 1;
+
+
+LazyHighlighter::LazyHighlighter(QPlainTextEdit* editor)
+    : QObject(editor)
+    , _editor(editor)
+    , _workerThread(new QThread)
+    , _worker(new HighlightWorker(CheckpointInterval))
+    , _generation(0)
+    , _lastJob(0)
+    , _requestedFirst(-1)
+    , _requestedLast(-1)
+    , _applied(0)
+    , _applying(false)
+    , _updateTimer(new QTimer(this))
+    , _applyTimer(new QTimer(this))
+{
+    qRegisterMetaType<HighlightResult>();
+
+    _checkpoints.append(KSyntaxHighlighting::State());
+
+    _worker->moveToThread(_workerThread);
+    connect(_worker, &HighlightWorker::highlighted, this, &LazyHighlighter::highlighted);
+    _workerThread->start();
+
+    // many changes (e.g. typing and scrolling) make one update
+    _updateTimer->setSingleShot(true);
+    _updateTimer->setInterval(0);
+    connect(_updateTimer, &QTimer::timeout, this, &LazyHighlighter::update);
+
+    // the event loop (e.g. painting) goes on between the slices
+    _applyTimer->setSingleShot(true);
+    _applyTimer->setInterval(0);
+    connect(_applyTimer, &QTimer::timeout, this, &LazyHighlighter::applyFormats);
+
+    connect(_editor->document(), &QTextDocument::contentsChange, this, &LazyHighlighter::invalidate);
+    connect(_editor->verticalScrollBar(), &QScrollBar::valueChanged, this, &LazyHighlighter::scheduleUpdate);
+    _editor->viewport()->installEventFilter(this);
+}
+
+
+LazyHighlighter::~LazyHighlighter()
+{
+    // the running job stops at the next line
+    _worker->supersede(-1);
+    _workerThread->quit();
+    _workerThread->wait();
+
+    delete _worker;
+    delete _workerThread;
+}
+
+
+void LazyHighlighter::setDefinition(const KSyntaxHighlighting::Definition &def)
+{
+    if (def == _definition) {
+        return;
+    }
+
+    // definitions are loaded lazily: load all of it (and of the
+    // definitions it includes) here, the worker thread just reads it
+    if (def.isValid()) {
+        def.formats();
+        const QVector<KSyntaxHighlighting::Definition> included = def.includedDefinitions();
+        for (const KSyntaxHighlighting::Definition& definition : included) {
+            definition.formats();
+        }
+    }
+    _definition = def;
+
+    _checkpoints.clear();
+    _checkpoints.append(KSyntaxHighlighting::State());
+    newGeneration();
+
+    clearFormats();
+    scheduleUpdate();
+}
+
+
+void LazyHighlighter::setTheme(const KSyntaxHighlighting::Theme &theme)
+{
+    _theme = theme;
+
+    // same states, new formats
+    newGeneration();
+    scheduleUpdate();
+}
+
+
+bool LazyHighlighter::eventFilter(QObject *watched, QEvent *event)
+{
+    // a bigger viewport shows more blocks
+    if (event->type() == QEvent::Resize) {
+        scheduleUpdate();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+
+void LazyHighlighter::invalidate(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+    Q_UNUSED(charsAdded)
+
+    if (_applying || !_definition.isValid()) {
+        return;
+    }
+
+    // the states after the edited block are lost
+    const int block = qMax(0, _editor->document()->findBlock(position).blockNumber());
+    const int valid = block / CheckpointInterval + 1;
+    if (_checkpoints.size() > valid) {
+        _checkpoints.resize(valid);
+    }
+
+    newGeneration();
+    scheduleUpdate();
+}
+
+
+void LazyHighlighter::newGeneration()
+{
+    ++_generation;
+
+    _requestedFirst = -1;
+    _requestedLast = -1;
+
+    _results.clear();
+    _applied = 0;
+    _applyTimer->stop();
+}
+
+
+void LazyHighlighter::scheduleUpdate()
+{
+    _updateTimer->start();
+}
+
+
+void LazyHighlighter::update()
+{
+    if (!_definition.isValid()) {
+        return;
+    }
+
+    // the visible blocks, plus the margin
+    const int firstVisible = _editor->cursorForPosition(QPoint(0, 0)).block().blockNumber();
+    const int lastVisible = _editor->cursorForPosition(QPoint(0, _editor->viewport()->height())).block().blockNumber();
+    const int first = qMax(0, firstVisible - MarginBlocks);
+    const int last = lastVisible + MarginBlocks;
+
+    // e.g. scrolling within the margin
+    if (_requestedFirst >= 0 && first >= _requestedFirst && last <= _requestedLast) {
+        return;
+    }
+
+    HighlightJob job;
+    job.id = ++_lastJob;
+    job.generation = _generation;
+    job.definition = _definition;
+    job.theme = _theme;
+
+    const int checkpoint = qMin(first / CheckpointInterval, _checkpoints.size() - 1);
+    job.firstLine = checkpoint * CheckpointInterval;
+    job.state = _checkpoints.at(checkpoint);
+    job.formatsFrom = first;
+
+    // far blocks: a chunk of the way at a time, just the states.
+    // The result asks for the next chunk
+    int lastLine = last;
+    if (first - job.firstLine > ChunkLines) {
+        lastLine = job.firstLine + ChunkLines - 1;
+        job.formatsFrom = lastLine + 1;
+        _requestedFirst = -1;
+        _requestedLast = -1;
+    } else {
+        _requestedFirst = first;
+        _requestedLast = last;
+    }
+
+    for (QTextBlock block = _editor->document()->findBlockByNumber(job.firstLine);
+         block.isValid() && block.blockNumber() <= lastLine; block = block.next()) {
+        job.lines.append(block.text());
+    }
+
+    HighlightWorker* worker = _worker;
+    worker->supersede(job.id);
+    QMetaObject::invokeMethod(worker, [worker, job]() {
+        worker->highlight(job);
+    }, Qt::QueuedConnection);
+}
+
+
+void LazyHighlighter::highlighted(const HighlightResult& result)
+{
+    // the document changed meanwhile
+    if (result.generation != _generation) {
+        return;
+    }
+
+    int index = result.firstLine / CheckpointInterval + 1;
+    for (const KSyntaxHighlighting::State& state : result.checkpoints) {
+        if (index == _checkpoints.size()) {
+            _checkpoints.append(state);
+        }
+        ++index;
+    }
+
+    // no formats: a chunk of the way toward far blocks (or a superseded job)
+    if (result.formats.isEmpty()) {
+        scheduleUpdate();
+        return;
+    }
+
+    _results.append(result);
+    if (!_applyTimer->isActive()) {
+        _applyTimer->start();
+    }
+}
+
+
+void LazyHighlighter::applyFormats()
+{
+    QTextDocument* document = _editor->document();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!_results.isEmpty()) {
+        const HighlightResult& result = _results.first();
+
+        // formats are set just where they changed
+        int dirtyFrom = -1;
+        int dirtyTo = -1;
+        bool sliceOver = false;
+        QTextBlock block = document->findBlockByNumber(result.formatsFrom + _applied);
+        for (; _applied < result.formats.size() && block.isValid() && !sliceOver; ++_applied, block = block.next()) {
+            const QVector<QTextLayout::FormatRange>& ranges = result.formats.at(_applied);
+            if (block.userState() != Formatted && ranges.isEmpty()) {
+                continue;
+            }
+
+            if (block.layout()->formats() != ranges) {
+                block.layout()->setFormats(ranges);
+                if (dirtyFrom < 0) {
+                    dirtyFrom = block.position();
+                }
+                dirtyTo = block.position() + block.length();
+            }
+            block.setUserState(ranges.isEmpty() ? -1 : Formatted);
+            sliceOver = (timer.elapsed() > SliceTime);
+        }
+
+        if (dirtyFrom >= 0) {
+            _applying = true;
+            document->markContentsDirty(dirtyFrom, dirtyTo - dirtyFrom);
+            _applying = false;
+        }
+
+        if (sliceOver && _applied < result.formats.size() && block.isValid()) {
+            _applyTimer->start();
+            return;
+        }
+
+        _results.removeFirst();
+        _applied = 0;
+    }
+}
+
+
+void LazyHighlighter::clearFormats()
+{
+    QTextDocument* document = _editor->document();
+
+    // the formatted blocks are usually few runs: one relayout each
+    int dirtyFrom = -1;
+    int dirtyTo = -1;
+    _applying = true;
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        if (block.userState() != Formatted) {
+            if (dirtyFrom >= 0) {
+                document->markContentsDirty(dirtyFrom, dirtyTo - dirtyFrom);
+                dirtyFrom = -1;
+            }
+            continue;
+        }
+
+        block.layout()->clearFormats();
+        block.setUserState(-1);
+        if (dirtyFrom < 0) {
+            dirtyFrom = block.position();
+        }
+        dirtyTo = block.position() + block.length();
+    }
+    if (dirtyFrom >= 0) {
+        document->markContentsDirty(dirtyFrom, dirtyTo - dirtyFrom);
+    }
+    _applying = false;
+}
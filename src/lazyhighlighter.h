@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef LAZYHIGHLIGHTER_H
+#define LAZYHIGHLIGHTER_H
+
+
+#include "highlightworker.h"
+
+#include <KSyntaxHighlighting/Definition>
+#include <KSyntaxHighlighting/State>
+#include <KSyntaxHighlighting/Theme>
+
+#include <QList>
+#include <QObject>
+#include <QVector>
+
+class QPlainTextEdit;
+class QTextBlock;
+class QThread;
+class QTimer;
+
+
+// Syntax highlighting of the visible blocks (plus a margin) only, where
+// QSyntaxHighlighter highlights the whole document up front.
+// The highlighter state is checkpointed every CheckpointInterval lines:
+// scrolling or jumping resumes from the nearest checkpoint above the
+// visible blocks, and an edit invalidates just the checkpoints after it.
+// The highlighter itself runs in a HighlightWorker thread, over a snapshot
+// of the lines: the GUI thread just sets the resulting formats, in time
+// boxed slices.
+class LazyHighlighter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LazyHighlighter(QPlainTextEdit* editor);
+    ~LazyHighlighter();
+
+    // an invalid definition removes the highlighting
+    void setDefinition(const KSyntaxHighlighting::Definition &def);
+    inline KSyntaxHighlighting::Definition definition() const { return _definition; };
+
+    void setTheme(const KSyntaxHighlighting::Theme &theme);
+    inline KSyntaxHighlighting::Theme theme() const { return _theme; };
+
+    // setting the formats marks the blocks dirty, and the document signals
+    // it as a contentsChange: true meanwhile, that is not an edit
+    inline bool isApplyingFormats() const { return _applying; };
+
+    static const int CheckpointInterval = 256;
+
+    // blocks highlighted above and below the visible ones
+    static const int MarginBlocks = 50;
+
+    // lines of a job walking toward far visible blocks, at most
+    static const int ChunkLines = 16384;
+
+    // ms setting formats before yielding to the event loop
+    static const int SliceTime = 5;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private Q_SLOTS:
+    void invalidate(int position, int charsRemoved, int charsAdded);
+    void scheduleUpdate();
+    void update();
+    void highlighted(const HighlightResult& result);
+    void applyFormats();
+
+private:
+    // removes the formats of all the blocks highlighted so far
+    void clearFormats();
+
+    // drops the states and the formats computed for the old document
+    void newGeneration();
+
+    QPlainTextEdit* _editor;
+
+    KSyntaxHighlighting::Definition _definition;
+    KSyntaxHighlighting::Theme _theme;
+
+    // the state before block i * CheckpointInterval
+    QVector<KSyntaxHighlighting::State> _checkpoints;
+
+    QThread* _workerThread;
+    HighlightWorker* _worker;
+    int _generation;
+    int _lastJob;
+
+    // the blocks the last job covers, to not ask them again
+    int _requestedFirst;
+    int _requestedLast;
+
+    // formats still to set: the first result, from its block _applied on
+    QList<HighlightResult> _results;
+    int _applied;
+
+    // marking the blocks dirty is not an edit
+    bool _applying;
+
+    QTimer* _updateTimer;
+    QTimer* _applyTimer;
+};
+
+
+#endif // LAZYHIGHLIGHTER_H
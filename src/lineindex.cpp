@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "lineindex.h"
+
+#include <QTextBlock>
+#include <QTextDocument>
+
+#include <QDebug>
+
+
+LineIndex::LineIndex(QTextDocument* document)
+    : QObject(document)
+    , _document(document)
+    , _deltaFrom(0)
+    , _delta(0)
+{
+    rebuild();
+
+    connect(_document, &QTextDocument::contentsChange, this, &LineIndex::update);
+}
+
+
+int LineIndex::lineCount() const
+{
+    return _starts.size();
+}
+
+
+int LineIndex::lineStart(int line) const
+{
+    return start( qBound(0, line, _starts.size() - 1) );
+}
+
+
+int LineIndex::lineForPosition(int position) const
+{
+    // the last line starting at or before position
+    int low = 0;
+    int high = _starts.size() - 1;
+    while (low < high) {
+        const int middle = low + (high - low + 1) / 2;
+        if (start(middle) <= position) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+
+int LineIndex::columnForPosition(int position) const
+{
+    return position - start( lineForPosition(position) );
+}
+
+
+void LineIndex::update(int position, int charsRemoved, int charsAdded)
+{
+    const int line = lineForPosition(position);
+    settleDelta(line);
+
+    // the following lines starting in the removed text are gone...
+    int removedEnd = line + 1;
+    while (removedEnd < _starts.size() && start(removedEnd) <= position + charsRemoved) {
+        ++removedEnd;
+    }
+
+    // ... and the ones starting in the added text are new
+    QVector<int> added;
+    QTextBlock block = _document->findBlock(position).next();
+    while (block.isValid() && block.position() <= position + charsAdded) {
+        added.append(block.position());
+        block = block.next();
+    }
+
+    // overwrite in place when we can (e.g. the highlighter just marking
+    // the text dirty), moving the tail of the array once at most
+    const int removed = removedEnd - (line + 1);
+    const int common = qMin(removed, added.size());
+    if (removed > common) {
+        _starts.remove(line + 1 + common, removed - common);
+    } else if (added.size() > common) {
+        _starts.insert(line + 1 + common, added.size() - common, 0);
+    }
+    for (int i = 0; i < added.size(); ++i) {
+        _starts[line + 1 + i] = added.at(i);
+    }
+
+    _deltaFrom = line + 1 + added.size();
+    _delta += charsAdded - charsRemoved;
+
+    // never trust a broken index
+    if (_starts.size() != _document->blockCount()) {
+        qDebug() << "line index out of sync, rebuilding it";
+        rebuild();
+    }
+}
+
+
+void LineIndex::rebuild()
+{
+    _starts.clear();
+    _starts.reserve(_document->blockCount());
+    for (QTextBlock block = _document->begin(); block.isValid(); block = block.next()) {
+        _starts.append(block.position());
+    }
+
+    _deltaFrom = _starts.size();
+    _delta = 0;
+}
+
+
+void LineIndex::settleDelta(int line)
+{
+    if (_delta != 0) {
+        if (_deltaFrom <= line) {
+            for (int i = _deltaFrom; i <= line; ++i) {
+                _starts[i] += _delta;
+            }
+        } else {
+            // exact starts become pending ones
+            for (int i = line + 1; i < _deltaFrom && i < _starts.size(); ++i) {
+                _starts[i] -= _delta;
+            }
+        }
+    }
+    _deltaFrom = line + 1;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+
+#include <QObject>
+#include <QVector>
+
+class QTextDocument;
+
+
+// The start position of every line of a document, in a flat array kept
+// up to date on QTextDocument::contentsChange.
+// The shift an edit causes to the following lines is not applied at once:
+// it is kept pending and settled just between two consecutive edit points,
+// so typing costs the same at the top of a 10 million lines file as at its end.
+class LineIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LineIndex(QTextDocument* document);
+
+    int lineCount() const;
+
+    // position of the first character of line (0 based)
+    int lineStart(int line) const;
+
+    int lineForPosition(int position) const;
+    int columnForPosition(int position) const;
+
+private Q_SLOTS:
+    void update(int position, int charsRemoved, int charsAdded);
+
+private:
+    void rebuild();
+
+    // makes the starts up to line exact, the following ones lacking _delta
+    void settleDelta(int line);
+
+    inline int start(int line) const {
+        return _starts.at(line) + (line >= _deltaFrom ? _delta : 0);
+    };
+
+    QTextDocument* _document;
+
+    QVector<int> _starts;
+
+    // pending shift of the lines from _deltaFrom on
+    int _deltaFrom;
+    int _delta;
+};
+
+
+#endif // LINEINDEX_H
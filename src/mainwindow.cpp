@@ -10,14 +10,21 @@
 #include "mainwindow.h"
 
 #include "application.h"
+#include "editjournal.h"
+#include "findinfilespanel.h"
+#include "largefileview.h"
+#include "lineindex.h"
 #include "replacebar.h"
+#include "regexsearch.h"
 #include "searchbar.h"
 #include "settingsdialog.h"
 #include "statusbar.h"
 #include "textedit.h"
 
 #include <QCloseEvent>
+#include <QDockWidget>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
@@ -26,7 +33,7 @@
 #include <QStandardPaths>
 #include <QStatusBar>
 #include <QTextCodec>
-#include <QTextStream>
+#include <QTimer>
 #include <QToolBar>
 #include <QVBoxLayout>
 
@@ -39,11 +46,19 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , _textEdit(new TextEdit(this))
+    , _largeFileView(new LargeFileView(this))
     , _searchBar(new SearchBar(this))
     , _replaceBar(new ReplaceBar(this))
     , _statusBar(new StatusBar(this))
+    , _journal(new EditJournal(_textEdit->document(), this))
+    , _statusBarTimer(new QTimer(this))
+    , _findInFilesDock(nullptr)
+    , _findInFilesPanel(nullptr)
     , _zoomRange(0)
     , _canBeReloaded(true)
+    , _largeFileMode(false)
+    , _pendingLine(0)
+    , _closeAfterSaving(false)
 {
     setAttribute(Qt::WA_DeleteOnClose);
 
@@ -52,18 +67,42 @@ MainWindow::MainWindow(QWidget *parent)
     auto layout = new QVBoxLayout;
     layout->setContentsMargins (0, 0, 0, 0);
     layout->addWidget (_textEdit);
+    layout->addWidget (_largeFileView);
     layout->addWidget (_searchBar);
     layout->addWidget (_replaceBar);
     w->setLayout (layout);
     setCentralWidget(w);
 
-    // let's start with the hidden bar(s)
+    // let's start with the TextEdit and the hidden bar(s)
+    _largeFileView->setVisible(false);
     _searchBar->setVisible(false);
     _replaceBar->setVisible(false);
 
     connect(_searchBar, &SearchBar::search, this, &MainWindow::search);
+    connect(_searchBar, &SearchBar::searchTyped, this, &MainWindow::searchAsYouType);
+    connect(_searchBar, &SearchBar::closed, this, [this]() {
+        _textEdit->setHighlightedText(QString(), Qt::CaseInsensitive);
+        _textEdit->regexSearch()->cancel();
+    });
     connect(this, &MainWindow::searchMessage, _searchBar, &SearchBar::searchMessage);
 
+    // regular expressions match in a worker thread: the results come later
+    RegexSearch* regexSearch = _textEdit->regexSearch();
+    connect(regexSearch, &RegexSearch::found, this, [this](bool found, bool restarted) {
+        if (restarted) {
+            Q_EMIT searchMessage( tr("Search restarted") );
+        }
+        if (!found) {
+            Q_EMIT searchMessage( tr("not found") );
+        }
+    });
+    connect(regexSearch, &RegexSearch::replaced, this, [this](int count) {
+        Q_EMIT searchMessage( tr("%n replacement(s)", "", count) );
+    });
+    connect(regexSearch, &RegexSearch::invalidPattern, this, [this](const QString& error) {
+        Q_EMIT searchMessage( tr("invalid pattern: %1").arg(error) );
+    });
+
     connect(_replaceBar, &ReplaceBar::replace, this, &MainWindow::replace);
 
     // restore geometry and state
@@ -82,11 +121,44 @@ MainWindow::MainWindow(QWidget *parent)
     setWindowIcon(appIcon);
 
     connect(_textEdit->document(), &QTextDocument::modificationChanged, this, &MainWindow::setWindowModified);
+    connect(_largeFileView, &LargeFileView::modificationChanged, this, &MainWindow::setWindowModified);
     setCurrentFilePath( QLatin1String("") );
 
+    // a crash does not lose the edits: see Application::recoverJournals()
+    _journal->start( QLatin1String("") );
+
     // take care of the statusbar
     statusBar()->addWidget(_statusBar);
-    connect(_textEdit, &QPlainTextEdit::cursorPositionChanged, this, &MainWindow::updateStatusBar);
+    // bursts (e.g. holding an arrow key, or a Replace All) make one update per frame.
+    // Deferred, anyway: the document signals the new cursor position before
+    // its contents change, that is before the line index is updated
+    _statusBarTimer->setSingleShot(true);
+    _statusBarTimer->setInterval(StatusBarInterval);
+    connect(_statusBarTimer, &QTimer::timeout, this, &MainWindow::updateStatusBar);
+    connect(_textEdit, &QPlainTextEdit::cursorPositionChanged, this, &MainWindow::scheduleStatusBarUpdate);
+    connect(_textEdit, &QPlainTextEdit::blockCountChanged, this, &MainWindow::scheduleStatusBarUpdate);
+
+    // file loading progress
+    connect(_textEdit, &TextEdit::loadProgress, _statusBar, &StatusBar::setProgress);
+    connect(_textEdit, &TextEdit::loadFinished, this, &MainWindow::loadFinished);
+    connect(_statusBar, &StatusBar::cancelRequested, _textEdit, &TextEdit::cancelLoading);
+
+    // file saving progress
+    connect(_textEdit, &TextEdit::saveProgress, _statusBar, &StatusBar::setProgress);
+    connect(_textEdit, &TextEdit::saveFinished, this, &MainWindow::saveFinished);
+    connect(_statusBar, &StatusBar::cancelRequested, _textEdit, &TextEdit::cancelSaving);
+
+    // large file indexing progress
+    connect(_largeFileView, &LargeFileView::cursorPositionChanged, this, &MainWindow::scheduleStatusBarUpdate);
+    connect(_largeFileView, &LargeFileView::indexProgress, _statusBar, &StatusBar::setProgress);
+    connect(_largeFileView, &LargeFileView::indexFinished, _statusBar, &StatusBar::hideProgress);
+    connect(_largeFileView, &LargeFileView::indexFinished, this, &MainWindow::updateStatusBar);
+    connect(_largeFileView, &LargeFileView::indexFinished, this, &MainWindow::gotoPendingLine);
+    connect(_statusBar, &StatusBar::cancelRequested, _largeFileView, &LargeFileView::cancelIndexing);
+
+    // large file saving progress
+    connect(_largeFileView, &LargeFileView::saveProgress, _statusBar, &StatusBar::setProgress);
+    connect(_largeFileView, &LargeFileView::saveFinished, this, &MainWindow::saveFinished);
 
     updateStatusBar();
 }
@@ -113,6 +185,9 @@ void MainWindow::loadSettings()
     int tabsCount = s.value( QStringLiteral("TabsCount"), 4).toInt();
     _textEdit->setTabsCount(tabsCount);
 
+    qint64 highlightingThreshold = s.value( QStringLiteral("HighlightingThreshold"), 16).toLongLong() * 1024 * 1024;
+    _textEdit->setHighlightingThreshold(highlightingThreshold);
+
     // font
     QString fontFamily = s.value( QStringLiteral("fontFamily"), QStringLiteral("Monospace") ).toString();
     int fontSize = s.value( QStringLiteral("fontSize"), 12).toInt();
@@ -121,6 +196,7 @@ void MainWindow::loadSettings()
     QFont font(fontFamily,fontSize + _zoomRange, fontWeight);
     font.setItalic(italic);
     _textEdit->setFont(font);
+    _largeFileView->setFont(font);
     QFontMetrics fm(font);
     _textEdit->setTabStopDistance( fm.horizontalAdvance( QChar(QChar::Space) ) * tabsCount );
 }
@@ -146,31 +222,141 @@ void MainWindow::tile(const QMainWindow *previous)
 
 void MainWindow::loadFilePath(const QString &path)
 {
-    QGuiApplication::setOverrideCursor(Qt::WaitCursor);
+    QSettings s;
+    qint64 threshold = s.value( QStringLiteral("LargeFileThreshold"), 256).toLongLong() * 1024 * 1024;
+
+    // loading is not an edit to record
+    _journal->discard();
+
+    // journals are replayed over a TextEdit document
+    if (_recoverJournal.isEmpty() && QFileInfo(path).size() > threshold && _largeFileView->openFile(path)) {
+        setLargeFileMode(true);
+        setCurrentFilePath(path);
+        _statusBar->showProgress( tr("Indexing %1").arg(QFileInfo(path).fileName()) );
+        updateStatusBar();
+        return;
+    }
+    setLargeFileMode(false);
+
+    // the window stays responsive while loading: see loadFinished()
+    _loadingPath = path;
+    _statusBar->showProgress( tr("Loading %1").arg(QFileInfo(path).fileName()) );
     _textEdit->loadFilePath(path);
-    QGuiApplication::restoreOverrideCursor();
+}
+
+
+void MainWindow::loadFinished(bool completed)
+{
+    _statusBar->hideProgress();
+
+    // a cancelled (so partial) load must NOT be saved over the original file
+    if (completed) {
+        setCurrentFilePath(_loadingPath);
+        gotoPendingLine();
+    } else {
+        setCurrentFilePath( QLatin1String("") );
+        _pendingLine = 0;
+    }
+
+    if (completed && !_recoverJournal.isEmpty()) {
+        _journal->recover(_recoverJournal);
+        _textEdit->document()->setModified(true);
+    } else {
+        _journal->start(completed ? _loadingPath : QString());
+    }
+    _recoverJournal.clear();
+    _loadingPath.clear();
+
+    // replacing the tabs rewrites the loaded text: the journal records it
+    if (completed) {
+        _textEdit->checkTabSpaceReplacementNeeded();
+    }
 
-    setCurrentFilePath(path);
     updateStatusBar();
 }
 
 
 void MainWindow::saveFilePath(const QString &path)
 {
+    // the line index is needed to go on editing the saved file
+    if (_largeFileMode && _largeFileView->isIndexing()) {
+        QMessageBox::information(this, tr("Please Wait"), tr("The file is still being indexed") );
+        return;
+    }
+
     // don't react to our file sytem modifications
     Application::instance()->removeWatchedPath(path);
 
-    QGuiApplication::setOverrideCursor(Qt::WaitCursor);
+    // the window stays responsive while saving: see saveFinished()
+    _savingPath = path;
+    _statusBar->showProgress( tr("Saving %1").arg(QFileInfo(path).fileName()) );
+
+    if (_largeFileMode) {
+        _largeFileView->saveFile(path);
+        return;
+    }
     _textEdit->saveFilePath(path);
-    QGuiApplication::restoreOverrideCursor();
+}
+
+
+void MainWindow::saveFinished(bool saved)
+{
+    _statusBar->hideProgress();
+
+    // the window stays open (the edits still unsaved), to retry
+    if (!saved) {
+        _savingPath.clear();
+        _closeAfterSaving = false;
+        if (!_filePath.isEmpty()) {
+            Application::instance()->addWatchedPath(_filePath);
+        }
+        return;
+    }
+
+    setCurrentFilePath(_savingPath);
+    _savingPath.clear();
+
+    // the saved large file is indexed again
+    if (_largeFileMode) {
+        _statusBar->showProgress( tr("Indexing %1").arg(QFileInfo(_filePath).fileName()) );
+        updateStatusBar();
+        closeIfSaved();
+        return;
+    }
+
+    // the saved file is the new journal base
+    _journal->start(_filePath);
+
+    // edits done while saving are not in the file
+    if (_textEdit->hasChangedSinceSave()) {
+        _journal->recordDocument();
+        _textEdit->document()->setModified(true);
+    }
 
-    setCurrentFilePath(path);
     updateStatusBar();
+    closeIfSaved();
+}
+
+
+void MainWindow::closeIfSaved()
+{
+    if (_closeAfterSaving) {
+        _closeAfterSaving = false;
+
+        // edits done while saving are asked for again
+        close();
+    }
 }
 
 
 bool MainWindow::exitAfterSaving()
 {
+    // a half loaded document has nothing to save
+    if (_textEdit->isLoading()) {
+        _textEdit->cancelLoading();
+        return true;
+    }
+
     if (isWindowModified()) {
 
         int risp = QMessageBox::question(this,
@@ -181,9 +367,11 @@ bool MainWindow::exitAfterSaving()
         switch(risp) {
 
             case QMessageBox::Save:
-                // save and exit
+                // the save runs in a worker thread: exit once it succeeds,
+                // stay open if it fails (or the Save As dialog is cancelled)
                 saveFile();
-                break;
+                _closeAfterSaving = !_savingPath.isEmpty();
+                return false;
 
             case QMessageBox::No:
                 // don't save and exit
@@ -223,13 +411,97 @@ void MainWindow::reloadChangedFile()
 }
 
 
+void MainWindow::gotoLine(int line)
+{
+    // wait for the whole file: see gotoPendingLine()
+    if (_textEdit->isLoading() || (_largeFileMode && _largeFileView->isIndexing())) {
+        _pendingLine = line;
+        return;
+    }
+
+    if (_largeFileMode) {
+        _largeFileView->gotoLine(line - 1);
+        _largeFileView->setFocus();
+        return;
+    }
+
+    _textEdit->gotoLine(line - 1);
+    _textEdit->setFocus();
+}
+
+
+QString MainWindow::documentSnapshot()
+{
+    if (_largeFileMode || _textEdit->isLoading()) {
+        return QString();
+    }
+    return _textEdit->searchSnapshot();
+}
+
+
+void MainWindow::showMatch(int position, int length)
+{
+    activateWindow();
+    raise();
+
+    if (_largeFileMode) {
+        return;
+    }
+
+    // the document can have been edited after the search
+    const int end = _textEdit->document()->characterCount() - 1;
+    position = qMin(position, end);
+    _textEdit->selectRange(position, qMin(length, end - position));
+    _textEdit->setFocus();
+}
+
+
+void MainWindow::recoverJournal(const QString & journal)
+{
+    QString basePath;
+    if (!EditJournal::readBase(journal, &basePath)) {
+        return;
+    }
+
+    if (basePath.isEmpty()) {
+        _journal->recover(journal);
+        _textEdit->document()->setModified(true);
+        return;
+    }
+
+    // replayed once loaded: see loadFinished()
+    _recoverJournal = journal;
+    loadFilePath(basePath);
+}
+
+
+void MainWindow::gotoPendingLine()
+{
+    if (_pendingLine > 0) {
+        gotoLine(_pendingLine);
+        _pendingLine = 0;
+    }
+}
+
+
 void MainWindow::closeEvent(QCloseEvent *event)
 {
+    // wait for the running save: see saveFinished()
+    if (!_savingPath.isEmpty()) {
+        _closeAfterSaving = true;
+        event->ignore();
+        return;
+    }
+
     if (exitAfterSaving()) {
         QSettings s;
         s.setValue( QStringLiteral("geometry") , saveGeometry());
         s.setValue( QStringLiteral("windowState") , saveState());
 
+        // closed cleanly (saved, or the edits dropped), nothing to recover.
+        // A failed save never gets here: see saveFinished()
+        _journal->discard();
+
         Application::instance()->removeWindowFromList(this);
         if (!_filePath.isEmpty()) {
             Application::instance()->removeWatchedPath(_filePath);
@@ -306,6 +578,7 @@ void MainWindow::setupActions()
     connect(actionSave, &QAction::triggered, this, &MainWindow::saveFile);
     actionSave->setEnabled(false);
     connect(_textEdit->document(), &QTextDocument::modificationChanged, actionSave, &QAction::setEnabled);
+    connect(_largeFileView, &LargeFileView::modificationChanged, actionSave, &QAction::setEnabled);
 
     // SAVE AS
     QAction* actionSaveAs = new QAction( QIcon::fromTheme( QStringLiteral("document-save-as"), QIcon( QStringLiteral(":/icons/document-save-as.svg") ) ) , tr("Save As"), this);
@@ -330,16 +603,30 @@ void MainWindow::setupActions()
     // UNDO
     QAction* actionUndo = new QAction( QIcon::fromTheme( QStringLiteral("edit-undo") , QIcon( QStringLiteral(":/icons/edit-undo.svg") ) ) , tr("Undo"), this );
     actionUndo->setShortcut(QKeySequence::Undo);
-    connect(actionUndo, &QAction::triggered, _textEdit, &TextEdit::undo );
+    connect(actionUndo, &QAction::triggered, this, [this]() {
+        if (_largeFileMode) {
+            _largeFileView->undo();
+        } else {
+            _textEdit->undo();
+        }
+    });
     actionUndo->setEnabled(false);
     connect(_textEdit, &QPlainTextEdit::undoAvailable, actionUndo, &QAction::setEnabled);
+    connect(_largeFileView, &LargeFileView::undoAvailable, actionUndo, &QAction::setEnabled);
 
     // REDO
     QAction* actionRedo = new QAction(QIcon::fromTheme( QStringLiteral("edit-redo") , QIcon( QStringLiteral(":/icons/edit-redo.svg") ) )  , tr("Redo"), this);
     actionRedo->setShortcut(QKeySequence::Redo);
-    connect(actionRedo, &QAction::triggered, _textEdit, &TextEdit::redo );
+    connect(actionRedo, &QAction::triggered, this, [this]() {
+        if (_largeFileMode) {
+            _largeFileView->redo();
+        } else {
+            _textEdit->redo();
+        }
+    });
     actionRedo->setEnabled(false);
     connect(_textEdit, &QPlainTextEdit::redoAvailable, actionRedo, &QAction::setEnabled);
+    connect(_largeFileView, &LargeFileView::redoAvailable, actionRedo, &QAction::setEnabled);
 
     // CUT
     QAction* actionCut = new QAction(QIcon::fromTheme( QStringLiteral("edit-cut") , QIcon( QStringLiteral(":/icons/edit-cut.svg") ) ) , tr("Cut"), this );
@@ -387,6 +674,13 @@ void MainWindow::setupActions()
     actionFullScreen->setCheckable(true);
     connect(actionFullScreen, &QAction::triggered, this, &MainWindow::onFullscreen );
 
+    // HIGHLIGHT SYNTAX (of a document too big to be highlighted as default)
+    QAction* actionHighlightSyntax = new QAction( tr("Highlight Syntax"), this );
+    connect(actionHighlightSyntax, &QAction::triggered, this, [this]() {
+        _textEdit->resumeHighlighting();
+        updateStatusBar();
+    });
+
     // find actions -----------------------------------------------------------------------------------------------------------
     // FIND
     QAction* actionFind = new QAction( QIcon::fromTheme( QStringLiteral("edit-find") , QIcon( QStringLiteral(":/icons/edit-find.svg") ) ) , tr("Find"), this );
@@ -398,6 +692,21 @@ void MainWindow::setupActions()
     actionReplace->setShortcut(QKeySequence::Replace);
     connect(actionReplace, &QAction::triggered, this, &MainWindow::showReplaceBar );
 
+    // GO TO LINE
+    QAction* actionGotoLine = new QAction( tr("Go to Line..."), this );
+    actionGotoLine->setShortcut(Qt::CTRL + Qt::Key_G);
+    connect(actionGotoLine, &QAction::triggered, this, &MainWindow::showGotoLineDialog );
+
+    // FIND IN ALL DOCUMENTS
+    QAction* actionFindAll = new QAction( tr("Find in All Documents..."), this );
+    actionFindAll->setShortcut(Qt::CTRL + Qt::ALT + Qt::Key_F);
+    connect(actionFindAll, &QAction::triggered, this, &MainWindow::showFindAllWindow );
+
+    // FIND IN FILES
+    QAction* actionFindInFiles = new QAction( tr("Find in Files..."), this );
+    actionFindInFiles->setShortcut(Qt::CTRL + Qt::SHIFT + Qt::Key_F);
+    connect(actionFindInFiles, &QAction::triggered, this, &MainWindow::showFindInFilesPanel );
+
     // option actions -----------------------------------------------------------------------------------------------------------
     // ENCODINGS
     QMenu* encodingsMenu = new QMenu( tr("Encodings... "), this);
@@ -491,10 +800,16 @@ void MainWindow::setupActions()
     viewMenu->addAction(actionZoomOriginal);
     viewMenu->addSeparator();
     viewMenu->addAction(actionFullScreen);
+    viewMenu->addSeparator();
+    viewMenu->addAction(actionHighlightSyntax);
 
     QMenu* searchMenu = menuBar()->addMenu( tr("&Search") );
     searchMenu->addAction(actionFind);
     searchMenu->addAction(actionReplace);
+    searchMenu->addAction(actionFindAll);
+    searchMenu->addAction(actionFindInFiles);
+    searchMenu->addSeparator();
+    searchMenu->addAction(actionGotoLine);
 
     QMenu* optionsMenu = menuBar()->addMenu( tr("&Options") );
     optionsMenu->addMenu(encodingsMenu);
@@ -559,6 +874,30 @@ void MainWindow::setCurrentFilePath(const QString& path)
 }
 
 
+void MainWindow::setLargeFileMode(bool on)
+{
+    if (_largeFileMode == on) {
+        return;
+    }
+    _largeFileMode = on;
+
+    // the (hidden) TextEdit has not to be edited, e.g. pasting in it
+    _textEdit->setReadOnly(on);
+    _textEdit->setVisible(!on);
+    _largeFileView->setVisible(on);
+
+    if (on) {
+        _textEdit->setPlainText(QString());
+        _largeFileView->setFocus();
+        return;
+    }
+
+    _largeFileView->closeFile();
+    _statusBar->hideProgress();
+    _textEdit->setFocus();
+}
+
+
 void MainWindow::newWindow()
 {
     Application::instance()->loadPath( QLatin1String("") );
@@ -623,6 +962,7 @@ void MainWindow::onZoomIn()
 {
     _zoomRange++;
     _textEdit->zoomIn();
+    _largeFileView->setFont(_textEdit->font());
     updateStatusBar();
 }
 
@@ -631,6 +971,7 @@ void MainWindow::onZoomOut()
 {
     _zoomRange--;
     _textEdit->zoomOut();
+    _largeFileView->setFont(_textEdit->font());
     updateStatusBar();
 }
 
@@ -643,6 +984,7 @@ void MainWindow::onZoomOriginal()
         _textEdit->zoomIn( _zoomRange * -1 );
     }
     _zoomRange = 0;
+    _largeFileView->setFont(_textEdit->font());
     updateStatusBar();
 }
 
@@ -692,19 +1034,40 @@ void MainWindow::showManual()
 }
 
 
+void MainWindow::scheduleStatusBarUpdate()
+{
+    // not restarted: a burst does not delay the update
+    if (!_statusBarTimer->isActive()) {
+        _statusBarTimer->start();
+    }
+}
+
+
 void MainWindow::updateStatusBar()
 {
-    if (_textEdit->language().isEmpty()) {
+    _statusBarTimer->stop();
+
+    if (_largeFileMode || _textEdit->language().isEmpty()) {
         _statusBar->setLanguage( tr("none") );
+    } else if (_textEdit->isHighlightingSuspended()) {
+        _statusBar->setLanguage( tr("%1 (not highlighted)").arg(_textEdit->language()) );
     } else {
         _statusBar->setLanguage(_textEdit->language());
     }
 
-    int row = _textEdit->textCursor().blockNumber();
-    int col = _textEdit->textCursor().positionInBlock();
-    _statusBar->setPosition(row,col);
+    if (_largeFileMode) {
+        _statusBar->setPosition(_largeFileView->currentLine(), _largeFileView->currentColumn());
+        _statusBar->setSelection(0);
+        _statusBar->setLineCount(_largeFileView->lineCount());
+    } else {
+        const QTextCursor cursor = _textEdit->textCursor();
+        const LineIndex* index = _textEdit->lineIndex();
+        _statusBar->setPosition(index->lineForPosition(cursor.position()), index->columnForPosition(cursor.position()));
+        _statusBar->setSelection(cursor.selectionEnd() - cursor.selectionStart());
+        _statusBar->setLineCount(index->lineCount());
+    }
 
-    QTextCodec* cod = _textEdit->textCodec();
+    QTextCodec* cod = _largeFileMode ? _largeFileView->textCodec() : _textEdit->textCodec();
     QString codecText = QStringLiteral("none");
     if (cod) {
         codecText = QLatin1String(cod->name());
@@ -725,6 +1088,13 @@ void MainWindow::encode()
     const QAction *action = qobject_cast<const QAction *>(sender());
     const QByteArray codecName = action->data().toByteArray();
     QTextCodec* targetCodec = QTextCodec::codecForName(codecName);
+
+    // the view just decodes the bytes again: nothing to save
+    if (_largeFileMode) {
+        _largeFileView->setTextCodec(targetCodec);
+        updateStatusBar();
+        return;
+    }
     
     _textEdit->encode(targetCodec);
 
@@ -745,6 +1115,39 @@ void MainWindow::showSettings()
 }
 
 
+void MainWindow::showFindAllWindow()
+{
+    Application::instance()->showFindAllWindow( _textEdit->textCursor().selectedText() );
+}
+
+
+void MainWindow::showFindInFilesPanel()
+{
+    if (!_findInFilesDock) {
+        _findInFilesPanel = new FindInFilesPanel(this);
+        connect(_findInFilesPanel, &FindInFilesPanel::resultActivated, this, [](const QString& path, int line) {
+            Application::instance()->gotoLine(path, line + 1);
+        });
+
+        _findInFilesDock = new QDockWidget( tr("Find in Files"), this);
+        _findInFilesDock->setObjectName( QStringLiteral("findInFilesDock") );
+        _findInFilesDock->setWidget(_findInFilesPanel);
+        addDockWidget(Qt::BottomDockWidgetArea, _findInFilesDock);
+    }
+
+    if (!_filePath.isEmpty()) {
+        _findInFilesPanel->setDefaultDirectory( QFileInfo(_filePath).absolutePath() );
+    }
+    const QString sel = _textEdit->textCursor().selectedText();
+    if (!sel.isEmpty()) {
+        _findInFilesPanel->setText(sel);
+    }
+
+    _findInFilesDock->show();
+    _findInFilesPanel->setFocus();
+}
+
+
 void MainWindow::showSearchBar()
 {
     if (_replaceBar->isVisible()) {
@@ -790,7 +1193,23 @@ void MainWindow::showReplaceBar()
 }
 
 
-void MainWindow::search(const QString & search, bool forward, bool casesensitive)
+void MainWindow::showGotoLineDialog()
+{
+    const LineIndex* index = _textEdit->lineIndex();
+    int current = _largeFileMode ? _largeFileView->currentLine() : index->lineForPosition(_textEdit->textCursor().position());
+    int max = _largeFileMode ? _largeFileView->lineCount() : index->lineCount();
+
+    bool ok;
+    int line = QInputDialog::getInt(this, tr("Go to Line"), tr("Line:"), current + 1, 1, max, 1, &ok);
+    if (!ok) {
+        return;
+    }
+
+    gotoLine(line);
+}
+
+
+void MainWindow::search(const QString & search, bool forward, bool casesensitive, bool regex)
 {
     QTextDocument::FindFlags flags;
 
@@ -802,7 +1221,40 @@ void MainWindow::search(const QString & search, bool forward, bool casesensitive
         flags |= QTextDocument::FindCaseSensitively;
     }
 
-    bool found = _textEdit->find(search, flags);
+    if (_largeFileMode && regex) {
+        Q_EMIT searchMessage( tr("not available for large files") );
+        return;
+    }
+
+    if (_largeFileMode) {
+        QGuiApplication::setOverrideCursor(Qt::WaitCursor);
+        bool found = _largeFileView->find(search, flags);
+        if (!found) {
+            if (forward) {
+                _largeFileView->moveCursorToStart();
+            } else {
+                _largeFileView->moveCursorToEnd();
+            }
+            Q_EMIT searchMessage( tr("Search restarted") );
+            found = _largeFileView->find(search, flags);
+        }
+        QGuiApplication::restoreOverrideCursor();
+        if (!found) {
+            Q_EMIT searchMessage( tr("not found") );
+        }
+        return;
+    }
+
+    if (regex) {
+        _textEdit->setHighlightedText(QString(), Qt::CaseInsensitive);
+        _textEdit->regexSearch()->find(search, flags);
+        return;
+    }
+
+    // all the (visible) matches, not just the found one
+    _textEdit->setHighlightedText(search, casesensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+
+    bool found = _textEdit->findText(search, flags);
     if (!found) {
         QTextCursor cur = _textEdit->textCursor();
         if (forward) {
@@ -812,7 +1264,7 @@ void MainWindow::search(const QString & search, bool forward, bool casesensitive
         }
         _textEdit->setTextCursor(cur);
         Q_EMIT searchMessage( tr("Search restarted") );
-        found = _textEdit->find(search, flags);
+        found = _textEdit->findText(search, flags);
         if (!found) {
             Q_EMIT searchMessage( tr("not found") );
             return;
@@ -821,6 +1273,57 @@ void MainWindow::search(const QString & search, bool forward, bool casesensitive
 }
 
 
+void MainWindow::searchAsYouType(const QString & search, bool casesensitive, bool regex)
+{
+    // a regular expression can take long to match: it waits for Enter,
+    // while the one still matching is useless
+    if (regex) {
+        _textEdit->regexSearch()->cancel();
+        return;
+    }
+
+    if (_largeFileMode) {
+        return;
+    }
+
+    const Qt::CaseSensitivity cs = casesensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    _textEdit->setHighlightedText(search, cs);
+    if (search.isEmpty()) {
+        return;
+    }
+
+    bool restarted;
+    if (!_textEdit->findAsYouType(search, cs, &restarted)) {
+        Q_EMIT searchMessage( tr("not found") );
+        return;
+    }
+    if (restarted) {
+        Q_EMIT searchMessage( tr("Search restarted") );
+    }
+}
+
+
+bool MainWindow::findOrRestart(const QString & search, QTextDocument::FindFlags flags)
+{
+    if (_textEdit->findText(search, flags)) {
+        return true;
+    }
+
+    const QTextCursor previous = _textEdit->textCursor();
+    QTextCursor cur = previous;
+    cur.movePosition(QTextCursor::Start);
+    _textEdit->setTextCursor(cur);
+    Q_EMIT searchMessage( tr("Search restarted") );
+    if (_textEdit->findText(search, flags)) {
+        return true;
+    }
+
+    // nothing to select: stay there
+    _textEdit->setTextCursor(previous);
+    return false;
+}
+
+
 void MainWindow::replace(const QString &replace, bool justNext)
 {
     QString search = _searchBar->text();
@@ -830,13 +1333,21 @@ void MainWindow::replace(const QString &replace, bool justNext)
         return;
     }
 
+    if (_largeFileMode) {
+        Q_EMIT searchMessage( tr("not available for large files") );
+        return;
+    }
+
     Qt::CaseSensitivity cs = matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive;
-    QString content = _textEdit->toPlainText();
+
+    if (_searchBar->regexChecked()) {
+        replaceRegex(search, replace, cs, justNext);
+        return;
+    }
 
     if (!justNext) {
-        content.replace(search, replace, cs);
-        _textEdit->setPlainText(content);
-        _textEdit->document()->setModified(true);
+        int count = _textEdit->replaceAll(search, replace, cs);
+        Q_EMIT searchMessage( tr("%n replacement(s)", "", count) );
         return;
     }
 
@@ -846,27 +1357,55 @@ void MainWindow::replace(const QString &replace, bool justNext)
         flags |= QTextDocument::FindCaseSensitively;
     }
 
-    bool found = _textEdit->find(search, flags);
-    if (!found) {
-        QTextCursor cur = _textEdit->textCursor();
-        cur.movePosition(QTextCursor::Start);
-        _textEdit->setTextCursor(cur);
-        Q_EMIT searchMessage( tr("Search restarted") );
-        found = _textEdit->find(search, flags);
-        if (!found) {
+    // the match selected by the previous Replace Next (or by a search) goes first
+    QTextCursor cur = _textEdit->textCursor();
+    if (!cur.hasSelection() || QString::compare(cur.selectedText(), search, cs) != 0) {
+        if (!findOrRestart(search, flags)) {
             Q_EMIT searchMessage( tr("not found") );
             return;
         }
+        cur = _textEdit->textCursor();
     }
-    int n = search.length();
-    int position = _textEdit->textCursor().position() - n;
-    content.replace(position, n, replace);
-    _textEdit->setPlainText(content);
-    _textEdit->document()->setModified(true);
-    QTextCursor cur = _textEdit->textCursor();
-    cur.setPosition(position + n);
+
+    // just the match is edited: undo history and scroll position are kept
+    cur.insertText(replace);
     _textEdit->setTextCursor(cur);
-    return;
+
+    // select the next one
+    findOrRestart(search, flags);
+}
+
+
+void MainWindow::replaceRegex(const QString & search, const QString & replace, Qt::CaseSensitivity cs, bool justNext)
+{
+    RegexSearch* regexSearch = _textEdit->regexSearch();
+
+    if (!justNext) {
+        regexSearch->replaceAll(search, replace, cs);
+        return;
+    }
+
+    if (!regexSearch->setPattern(search, cs)) {
+        return;
+    }
+
+    // the match selected by the previous Replace Next (or by a search) is
+    // replaced, else the first one gets selected: matching is asynchronous
+    QTextCursor cur = _textEdit->textCursor();
+    QString selected = cur.selectedText();
+    selected.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+
+    QString replaced;
+    if (cur.hasSelection() && regexSearch->replacementFor(selected, replace, &replaced)) {
+        cur.insertText(replaced);
+        _textEdit->setTextCursor(cur);
+    }
+
+    QTextDocument::FindFlags flags;
+    if (cs == Qt::CaseSensitive) {
+        flags |= QTextDocument::FindCaseSensitively;
+    }
+    regexSearch->find(search, flags);
 }
 
 
@@ -12,10 +12,16 @@
 
 
 #include <QMainWindow>
+#include <QTextDocument>
 
 class QCloseEvent;
+class QDockWidget;
 class QKeyEvent;
+class QTimer;
 
+class EditJournal;
+class FindInFilesPanel;
+class LargeFileView;
 class TextEdit;
 class SearchBar;
 class ReplaceBar;
@@ -40,15 +46,35 @@ public:
     // from the outside
     void loadFilePath(const QString & path);
     void saveFilePath(const QString & path);
+
+    // line is 1 based, as the user sees it.
+    // While loading, the cursor goes there once the file is loaded
+    void gotoLine(int line);
+
+    // the document as plain text (shared, not copied), for searches
+    // over all the windows: empty for a large file
+    QString documentSnapshot();
+    inline QString documentName() const { return windowFilePath(); }
+
+    // brings the window up, selecting length characters from position
+    void showMatch(int position, int length);
+
+    // loads the base file of journal and replays the edits
+    // of a crashed session over it
+    void recoverJournal(const QString & journal);
     
     // ask user to save or not, eventually blocking exit action
     // returns true if window has to be closed, false otherwise
+    // (e.g. while saving: it is closed once saved, see saveFinished())
     bool exitAfterSaving();
 
     // reload file modified OUTSIDE of cutepad management
     // (asking user before)
     void reloadChangedFile();
 
+    // ms between two status bar updates, at least: one per frame
+    static const int StatusBarInterval = 16;
+
 protected:
     void closeEvent(QCloseEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
@@ -57,6 +83,20 @@ private:
     void setupActions();
 
     void setCurrentFilePath(const QString& path);
+
+    // closes the window, if a save was asked for by closing it
+    void closeIfSaved();
+
+    // files bigger than the LargeFileThreshold setting are shown
+    // in a LargeFileView, instead of the TextEdit
+    void setLargeFileMode(bool on);
+
+    // finds the next match, restarting from the top when needed
+    bool findOrRestart(const QString & search, QTextDocument::FindFlags flags);
+
+    // Replace (All) with a regular expression: \1... stand for its captured texts
+    void replaceRegex(const QString & search, const QString & replace, Qt::CaseSensitivity cs, bool justNext);
+
     void addPathToRecentFiles(const QString& path);
 
 private Q_SLOTS:
@@ -76,15 +116,26 @@ private Q_SLOTS:
     void about();
     void showManual();
 
+    void scheduleStatusBarUpdate();
     void updateStatusBar();
     void encode();
 
+    void loadFinished(bool completed);
+    void saveFinished(bool saved);
+
     void showSearchBar();
     void showReplaceBar();
+    void showGotoLineDialog();
+    void showFindAllWindow();
+    void showFindInFilesPanel();
+    void gotoPendingLine();
 
     void search(const QString & search,
                 bool forward = true,
-                bool casesensitive = false);
+                bool casesensitive = false,
+                bool regex = false);
+
+    void searchAsYouType(const QString & search, bool casesensitive, bool regex);
 
     void replace(const QString &replace, bool justNext = true);
 
@@ -95,13 +146,28 @@ Q_SIGNALS:
 
 private:
     TextEdit* _textEdit;
+    LargeFileView* _largeFileView;
     SearchBar* _searchBar;
     ReplaceBar* _replaceBar;
     StatusBar* _statusBar;
+    EditJournal* _journal;
+    QTimer* _statusBarTimer;
+
+    // created when first needed
+    QDockWidget* _findInFilesDock;
+    FindInFilesPanel* _findInFilesPanel;
 
     QString _filePath;
+    QString _loadingPath;
+    QString _savingPath;
+    QString _recoverJournal;
     int _zoomRange;
     bool _canBeReloaded;
+    bool _largeFileMode;
+    int _pendingLine;
+
+    // the window is closed once the running save succeeds
+    bool _closeAfterSaving;
 };
 
 #endif // MAINWINDOW_H
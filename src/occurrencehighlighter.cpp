@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "occurrencehighlighter.h"
+
+#include "lazyhighlighter.h"
+
+#include <QEvent>
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTimer>
+
+#include <algorithm>
+
+
+OccurrenceHighlighter::OccurrenceHighlighter(QPlainTextEdit* editor)
+    : QObject(editor)
+    , _editor(editor)
+    , _syntaxHighlighter(nullptr)
+    , _cs(Qt::CaseInsensitive)
+    , _blockCount(0)
+    , _blocksDropped(false)
+    , _updateTimer(new QTimer(this))
+{
+    // many changes (e.g. typing and highlighting) make one update
+    _updateTimer->setSingleShot(true);
+    _updateTimer->setInterval(0);
+    connect(_updateTimer, &QTimer::timeout, this, &OccurrenceHighlighter::update);
+
+    connect(_editor->document(), &QTextDocument::contentsChange, this, &OccurrenceHighlighter::invalidate);
+    connect(_editor->verticalScrollBar(), &QScrollBar::valueChanged, this, &OccurrenceHighlighter::scheduleUpdate);
+    _editor->viewport()->installEventFilter(this);
+}
+
+
+void OccurrenceHighlighter::setPattern(const QString& pattern, Qt::CaseSensitivity cs)
+{
+    if (pattern == _pattern && cs == _cs) {
+        return;
+    }
+
+    _pattern = pattern;
+    _cs = cs;
+    _blocks.clear();
+    _blockCount = _editor->document()->blockCount();
+    _blocksDropped = false;
+
+    // the old matches go away at once
+    _selections.clear();
+    Q_EMIT selectionsChanged();
+
+    scheduleUpdate();
+}
+
+
+void OccurrenceHighlighter::setSyntaxHighlighter(const LazyHighlighter* highlighter)
+{
+    _syntaxHighlighter = highlighter;
+}
+
+
+bool OccurrenceHighlighter::eventFilter(QObject *watched, QEvent *event)
+{
+    // a bigger viewport shows more blocks
+    if (event->type() == QEvent::Resize) {
+        scheduleUpdate();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+
+void OccurrenceHighlighter::invalidate(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+
+    // new formats, same text
+    if (_pattern.isEmpty() || (_syntaxHighlighter && _syntaxHighlighter->isApplyingFormats())) {
+        return;
+    }
+
+    const QTextDocument* document = _editor->document();
+    const int first = document->findBlock(position).blockNumber();
+    QTextBlock lastBlock = document->findBlock(position + charsAdded);
+    const int last = lastBlock.isValid() ? lastBlock.blockNumber() : document->blockCount() - 1;
+
+    // the blocks after the edit are renumbered by the blocks it added
+    // (or removed): old blocks up to oldLast were edited
+    const int added = document->blockCount() - _blockCount;
+    const int oldLast = last - added;
+    _blockCount = document->blockCount();
+
+    QHash<int, BlockMatches> blocks;
+    for (QHash<int, BlockMatches>::iterator it = _blocks.begin(); it != _blocks.end(); ++it) {
+        const int number = it.key();
+        if (number < first) {
+            blocks.insert(number, it.value());
+        } else if (number <= qMin(last, oldLast)) {
+            it.value().stale = true;
+            blocks.insert(number, it.value());
+        } else if (number <= oldLast) {
+            _blocksDropped = _blocksDropped || !it.value().selections.isEmpty();
+        } else {
+            blocks.insert(number + added, it.value());
+        }
+    }
+    _blocks = blocks;
+    scheduleUpdate();
+}
+
+
+void OccurrenceHighlighter::scheduleUpdate()
+{
+    _updateTimer->start();
+}
+
+
+void OccurrenceHighlighter::update()
+{
+    QHash<int, BlockMatches> blocks;
+    bool changed = _blocksDropped;
+    _blocksDropped = false;
+
+    if (!_pattern.isEmpty()) {
+        // the visible blocks, plus the margin
+        QTextBlock block = _editor->cursorForPosition(QPoint(0, 0)).block();
+        const int lastVisible = _editor->cursorForPosition(QPoint(0, _editor->viewport()->height())).block().blockNumber();
+        for (int i = 0; i < MarginBlocks && block.previous().isValid(); ++i) {
+            block = block.previous();
+        }
+        const int last = lastVisible + MarginBlocks;
+
+        for (; block.isValid() && block.blockNumber() <= last; block = block.next()) {
+            const int number = block.blockNumber();
+
+            QHash<int, BlockMatches>::iterator cached = _blocks.find(number);
+            if (cached != _blocks.end() && !cached.value().stale) {
+                blocks.insert(number, cached.value());
+                _blocks.erase(cached);
+                continue;
+            }
+
+            QVector<int> columns;
+            const QString text = block.text();
+            int column = text.indexOf(_pattern, 0, _cs);
+            while (column >= 0) {
+                columns.append(column);
+                column = text.indexOf(_pattern, column + _pattern.length(), _cs);
+            }
+
+            // e.g. typing after the matches of the block
+            BlockMatches matches;
+            if (cached != _blocks.end() && isCurrent(block, cached.value(), columns)) {
+                matches = cached.value();
+            } else {
+                matches.columns = columns;
+                matches.selections = selectionsFor(block, columns);
+                const bool hadSelections = (cached != _blocks.end() && !cached.value().selections.isEmpty());
+                changed = changed || hadSelections || !matches.selections.isEmpty();
+            }
+            if (cached != _blocks.end()) {
+                _blocks.erase(cached);
+            }
+            matches.stale = false;
+            blocks.insert(number, matches);
+        }
+    }
+
+    // blocks far away are dropped: the cache stays small
+    for (QHash<int, BlockMatches>::const_iterator it = _blocks.constBegin(); it != _blocks.constEnd(); ++it) {
+        changed = changed || !it.value().selections.isEmpty();
+    }
+    _blocks = blocks;
+
+    // e.g. scrolling within the margin: nothing changed
+    if (!changed) {
+        return;
+    }
+
+    QList<int> numbers = _blocks.keys();
+    std::sort(numbers.begin(), numbers.end());
+
+    _selections.clear();
+    for (int number : qAsConst(numbers)) {
+        _selections += _blocks.value(number).selections;
+    }
+
+    Q_EMIT selectionsChanged();
+}
+
+
+QList<QTextEdit::ExtraSelection> OccurrenceHighlighter::selectionsFor(const QTextBlock& block, const QVector<int>& columns) const
+{
+    QTextCharFormat format;
+    format.setBackground( QColor(Qt::green).lighter(160) );
+
+    QList<QTextEdit::ExtraSelection> selections;
+    for (int column : columns) {
+        const int position = block.position() + column;
+        QTextEdit::ExtraSelection selection;
+        selection.format = format;
+        selection.cursor = QTextCursor(_editor->document());
+        selection.cursor.setPosition(position);
+        selection.cursor.setPosition(position + _pattern.length(), QTextCursor::KeepAnchor);
+        selections.append(selection);
+    }
+    return selections;
+}
+
+
+bool OccurrenceHighlighter::isCurrent(const QTextBlock& block, const BlockMatches& matches, const QVector<int>& columns) const
+{
+    if (matches.columns != columns) {
+        return false;
+    }
+
+    // the selections follow the edits, but may have been cut by them
+    for (int i = 0; i < columns.size(); ++i) {
+        const QTextCursor& cursor = matches.selections.at(i).cursor;
+        if (cursor.selectionStart() != block.position() + columns.at(i)
+                || cursor.selectionEnd() != block.position() + columns.at(i) + _pattern.length()) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef OCCURRENCEHIGHLIGHTER_H
+#define OCCURRENCEHIGHLIGHTER_H
+
+
+#include <QHash>
+#include <QObject>
+#include <QTextEdit>
+#include <QVector>
+
+class LazyHighlighter;
+class QPlainTextEdit;
+class QTextBlock;
+class QTimer;
+
+
+// Highlights all the occurrences of a text, as extra selections.
+// Just the visible blocks (plus a margin) are scanned and their matches
+// and selections are kept per block: an edit rescans the blocks it
+// touches (the selections of the others follow the text on their own),
+// scrolling scans just the blocks coming in. The selections are handed
+// out again only when the ones of a block changed.
+class OccurrenceHighlighter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OccurrenceHighlighter(QPlainTextEdit* editor);
+
+    // an empty pattern highlights nothing
+    void setPattern(const QString& pattern, Qt::CaseSensitivity cs);
+
+    // the syntax highlighter of the editor: its formats keep the matches
+    void setSyntaxHighlighter(const LazyHighlighter* highlighter);
+
+    inline QList<QTextEdit::ExtraSelection> selections() const { return _selections; };
+
+    // blocks scanned above and below the visible ones
+    static const int MarginBlocks = 50;
+
+Q_SIGNALS:
+    void selectionsChanged();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private Q_SLOTS:
+    void invalidate(int position, int charsRemoved, int charsAdded);
+    void scheduleUpdate();
+    void update();
+
+private:
+    struct BlockMatches {
+        QVector<int> columns;
+        QList<QTextEdit::ExtraSelection> selections;
+        // edited: to be scanned again
+        bool stale;
+    };
+
+    QList<QTextEdit::ExtraSelection> selectionsFor(const QTextBlock& block, const QVector<int>& columns) const;
+
+    // whether the selections of matches still cover columns of block
+    bool isCurrent(const QTextBlock& block, const BlockMatches& matches, const QVector<int>& columns) const;
+
+    QPlainTextEdit* _editor;
+    const LazyHighlighter* _syntaxHighlighter;
+
+    QString _pattern;
+    Qt::CaseSensitivity _cs;
+
+    // block number -> its matches
+    QHash<int, BlockMatches> _blocks;
+    int _blockCount;
+
+    // some selections went away with their blocks
+    bool _blocksDropped;
+
+    QList<QTextEdit::ExtraSelection> _selections;
+
+    QTimer* _updateTimer;
+};
+
+
+#endif // OCCURRENCEHIGHLIGHTER_H
@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "piecetable.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+// older steps are dropped
+static const int MaxUndoSteps = 10000;
+
+
+PieceTable::PieceTable()
+    : _original(nullptr)
+    , _originalSize(0)
+    , _size(0)
+    , _newlines(0)
+    , _typingOffset(-1)
+{
+}
+
+
+void PieceTable::setOriginal(const char* data, qint64 size)
+{
+    clear();
+
+    _original = data;
+    _originalSize = size;
+    _checkpoints.append(0);
+
+    if (size > 0) {
+        Piece piece = { Original, 0, size, 0 };
+        _pieces.append(piece);
+    }
+    _size = size;
+}
+
+
+void PieceTable::clear()
+{
+    _original = nullptr;
+    _originalSize = 0;
+    _checkpoints.clear();
+
+    _added.clear();
+    _addedNewlines.clear();
+
+    _pieces.clear();
+    _size = 0;
+    _newlines = 0;
+
+    _undoStack.clear();
+    _redoStack.clear();
+    _typingOffset = -1;
+}
+
+
+void PieceTable::addOriginalCheckpoints(const QVector<qint64>& checkpoints, int lineCount)
+{
+    _checkpoints += checkpoints;
+
+    // while indexing, the document is still the whole original buffer
+    if (_pieces.size() == 1 && _pieces.at(0).buffer == Original) {
+        _pieces[0].newlines = lineCount - 1;
+        _newlines = lineCount - 1;
+    }
+}
+
+
+qint64 PieceTable::size() const
+{
+    return _size;
+}
+
+
+int PieceTable::lineCount() const
+{
+    return _newlines + 1;
+}
+
+
+qint64 PieceTable::lineStart(int line) const
+{
+    if (line <= 0) {
+        return 0;
+    }
+
+    // line starts right after the line-th new line
+    qint64 offset = 0;
+    int newlines = 0;
+    for (const Piece& piece : _pieces) {
+        if (newlines + piece.newlines >= line) {
+            qint64 nl = nthNewline(piece.buffer, piece.start, line - newlines);
+            return offset + (nl - piece.start) + 1;
+        }
+        newlines += piece.newlines;
+        offset += piece.length;
+    }
+    return _size;
+}
+
+
+qint64 PieceTable::lineEnd(qint64 start) const
+{
+    qint64 offset = 0;
+    for (const Piece& piece : _pieces) {
+        if (start < offset + piece.length) {
+            const qint64 from = qMax<qint64>(0, start - offset);
+            const char* begin = data(piece);
+            const char* nl = static_cast<const char*>(memchr(begin + from, '\n', piece.length - from));
+            if (nl) {
+                return offset + (nl - begin);
+            }
+        }
+        offset += piece.length;
+    }
+    return _size;
+}
+
+
+int PieceTable::lineForOffset(qint64 offset) const
+{
+    qint64 pieceOffset = 0;
+    int newlines = 0;
+    for (const Piece& piece : _pieces) {
+        if (offset < pieceOffset + piece.length) {
+            return newlines + newlinesIn(piece.buffer, piece.start, offset - pieceOffset);
+        }
+        newlines += piece.newlines;
+        pieceOffset += piece.length;
+    }
+    return newlines;
+}
+
+
+QByteArray PieceTable::bytes(qint64 offset, qint64 length) const
+{
+    QByteArray result;
+    result.reserve(int(length));
+
+    const qint64 end = offset + length;
+    qint64 pieceOffset = 0;
+    for (const Piece& piece : _pieces) {
+        const qint64 pieceEnd = pieceOffset + piece.length;
+        if (pieceEnd > offset && pieceOffset < end) {
+            const qint64 from = qMax(offset, pieceOffset) - pieceOffset;
+            const qint64 to = qMin(end, pieceEnd) - pieceOffset;
+            result.append(data(piece) + from, int(to - from));
+        }
+        if (pieceEnd >= end) {
+            break;
+        }
+        pieceOffset = pieceEnd;
+    }
+    return result;
+}
+
+
+void PieceTable::insert(qint64 offset, const QByteArray& bytes)
+{
+    if (bytes.isEmpty() || offset < 0 || offset > _size) {
+        return;
+    }
+
+    qint64 pieceOffset;
+    const int index = pieceAt(offset, &pieceOffset);
+
+    // go on typing: extend the piece of the previous insertion
+    // (the last undo step, which is extended too)
+    const bool extend = (offset == _typingOffset && index > 0 && !_undoStack.isEmpty()
+                         && pieceOffset == offset
+                         && _pieces.at(index - 1).buffer == Added
+                         && _pieces.at(index - 1).start + _pieces.at(index - 1).length == _added.size());
+
+    const qint64 addedStart = _added.size();
+    _added.append(bytes);
+
+    int newlines = 0;
+    const char* begin = bytes.constData();
+    const char* nl = static_cast<const char*>(memchr(begin, '\n', bytes.size()));
+    while (nl) {
+        _addedNewlines.append(addedStart + (nl - begin));
+        ++newlines;
+        nl = static_cast<const char*>(memchr(nl + 1, '\n', bytes.size() - (nl + 1 - begin)));
+    }
+
+    if (extend) {
+        Change& last = _undoStack.last();
+        Piece& typed = last.after[index - 1 - last.index];
+        typed.length += bytes.size();
+        typed.newlines += newlines;
+        _pieces[index - 1] = typed;
+        _size += bytes.size();
+        _newlines += newlines;
+    } else {
+        const Piece added = { Added, addedStart, bytes.size(), newlines };
+
+        Change change;
+        change.index = index;
+        change.offset = offset;
+        if (index < _pieces.size() && pieceOffset < offset) {
+            // in the middle of a piece: it is split around the new one
+            const Piece& piece = _pieces.at(index);
+            const qint64 head = offset - pieceOffset;
+            change.before << piece;
+            change.after << slice(piece, 0, head) << added << slice(piece, head, piece.length - head);
+        } else {
+            change.after << added;
+        }
+        apply(change);
+    }
+
+    _typingOffset = offset + bytes.size();
+    _redoStack.clear();
+}
+
+
+void PieceTable::remove(qint64 offset, qint64 length)
+{
+    length = qMin(length, _size - offset);
+    if (length <= 0 || offset < 0) {
+        return;
+    }
+
+    qint64 firstOffset;
+    qint64 lastOffset;
+    const int first = pieceAt(offset, &firstOffset);
+    const int last = pieceAt(offset + length - 1, &lastOffset);
+
+    Change change;
+    change.index = first;
+    change.offset = offset;
+    for (int i = first; i <= last; ++i) {
+        change.before << _pieces.at(i);
+    }
+
+    // what is left of the first and of the last piece
+    if (offset > firstOffset) {
+        change.after << slice(_pieces.at(first), 0, offset - firstOffset);
+    }
+    const Piece& lastPiece = _pieces.at(last);
+    const qint64 tail = offset + length - lastOffset;
+    if (tail < lastPiece.length) {
+        change.after << slice(lastPiece, tail, lastPiece.length - tail);
+    }
+
+    apply(change);
+    _typingOffset = -1;
+    _redoStack.clear();
+}
+
+
+bool PieceTable::isUndoAvailable() const
+{
+    return !_undoStack.isEmpty();
+}
+
+
+bool PieceTable::isRedoAvailable() const
+{
+    return !_redoStack.isEmpty();
+}
+
+
+qint64 PieceTable::undo()
+{
+    if (_undoStack.isEmpty()) {
+        return -1;
+    }
+
+    const Change change = _undoStack.takeLast();
+    replace(change.index, change.after.size(), change.before);
+    _redoStack.append(change);
+
+    _typingOffset = -1;
+    return change.offset;
+}
+
+
+qint64 PieceTable::redo()
+{
+    if (_redoStack.isEmpty()) {
+        return -1;
+    }
+
+    const Change change = _redoStack.takeLast();
+    replace(change.index, change.before.size(), change.after);
+    _undoStack.append(change);
+
+    _typingOffset = -1;
+    return change.offset;
+}
+
+
+const char* PieceTable::data(const Piece& piece) const
+{
+    return (piece.buffer == Original ? _original : _added.constData()) + piece.start;
+}
+
+
+int PieceTable::newlinesIn(Buffer buffer, qint64 start, qint64 length) const
+{
+    if (buffer == Original) {
+        return originalLineForOffset(start + length) - originalLineForOffset(start);
+    }
+
+    QVector<qint64>::const_iterator first = std::lower_bound(_addedNewlines.constBegin(), _addedNewlines.constEnd(), start);
+    QVector<qint64>::const_iterator last = std::lower_bound(first, _addedNewlines.constEnd(), start + length);
+    return int(last - first);
+}
+
+
+qint64 PieceTable::nthNewline(Buffer buffer, qint64 start, int n) const
+{
+    if (buffer == Original) {
+        // the n-th new line after start ends the line before this one
+        return originalLineStart(originalLineForOffset(start) + n) - 1;
+    }
+
+    QVector<qint64>::const_iterator first = std::lower_bound(_addedNewlines.constBegin(), _addedNewlines.constEnd(), start);
+    return *(first + (n - 1));
+}
+
+
+int PieceTable::pieceAt(qint64 offset, qint64* pieceOffset) const
+{
+    qint64 position = 0;
+    for (int i = 0; i < _pieces.size(); ++i) {
+        if (offset < position + _pieces.at(i).length) {
+            *pieceOffset = position;
+            return i;
+        }
+        position += _pieces.at(i).length;
+    }
+    *pieceOffset = position;
+    return _pieces.size();
+}
+
+
+PieceTable::Piece PieceTable::slice(const Piece& piece, qint64 from, qint64 length) const
+{
+    const Piece result = { piece.buffer, piece.start + from, length, newlinesIn(piece.buffer, piece.start + from, length) };
+    return result;
+}
+
+
+void PieceTable::replace(int index, int count, const QVector<Piece>& pieces)
+{
+    for (int i = index; i < index + count; ++i) {
+        _size -= _pieces.at(i).length;
+        _newlines -= _pieces.at(i).newlines;
+    }
+    for (const Piece& piece : pieces) {
+        _size += piece.length;
+        _newlines += piece.newlines;
+    }
+
+    _pieces.remove(index, count);
+    for (int i = 0; i < pieces.size(); ++i) {
+        _pieces.insert(index + i, pieces.at(i));
+    }
+}
+
+
+void PieceTable::apply(const Change& change)
+{
+    replace(change.index, change.before.size(), change.after);
+
+    _undoStack.append(change);
+    if (_undoStack.size() > MaxUndoSteps) {
+        _undoStack.removeFirst();
+    }
+}
+
+
+qint64 PieceTable::originalLineStart(int line) const
+{
+    // nearest checkpoint, then (at most LineStride) line jumps
+    int checkpoint = qMin(line / LineStride, _checkpoints.size() - 1);
+    qint64 offset = _checkpoints.at(checkpoint);
+    for (int i = checkpoint * LineStride; i < line; ++i) {
+        const char* nl = static_cast<const char*>(memchr(_original + offset, '\n', _originalSize - offset));
+        if (!nl) {
+            return _originalSize;
+        }
+        offset = nl - _original + 1;
+    }
+    return offset;
+}
+
+
+int PieceTable::originalLineForOffset(qint64 offset) const
+{
+    QVector<qint64>::const_iterator it = std::upper_bound(_checkpoints.constBegin(), _checkpoints.constEnd(), offset);
+    int checkpoint = int(it - _checkpoints.constBegin()) - 1;
+
+    int line = checkpoint * LineStride;
+    qint64 position = _checkpoints.at(checkpoint);
+    while (position < offset) {
+        const char* nl = static_cast<const char*>(memchr(_original + position, '\n', offset - position));
+        if (!nl) {
+            break;
+        }
+        ++line;
+        position = nl - _original + 1;
+    }
+    return line;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+
+// A piece table over (encoded) bytes.
+// The original buffer is read only (a memory mapped file), the added text
+// goes to an append only buffer and the document is the sequence of the
+// pieces (slices of the two buffers). Edits, undo and redo just change
+// the (small) piece list: their cost does not depend on the file size.
+//
+// Lines are counted on '\n' bytes, so the encoding has to be ASCII compatible.
+// The original buffer line index is sparse (an offset every LineStride lines)
+// and is fed while indexing: the table has not to be edited before it is complete.
+//
+// Undo steps keep just what an edit replaced: the pieces it took out and
+// the ones it put in their place, so the history costs the size of the
+// edits, not of the piece list.
+//
+// It is a value class: copies are cheap (implicitly shared) snapshots,
+// e.g. to save the document in a worker thread.
+class PieceTable
+{
+public:
+    PieceTable();
+
+    void setOriginal(const char* data, qint64 size);
+    void clear();
+
+    // the original buffer line index, an offset every LineStride lines
+    void addOriginalCheckpoints(const QVector<qint64>& checkpoints, int lineCount);
+
+    qint64 size() const;
+    int lineCount() const;
+
+    // offset of the first byte of line
+    qint64 lineStart(int line) const;
+
+    // offset of the '\n' ending the line starting at start (size() for the last one)
+    qint64 lineEnd(qint64 start) const;
+
+    int lineForOffset(qint64 offset) const;
+
+    // materialize length bytes, from offset
+    QByteArray bytes(qint64 offset, qint64 length) const;
+
+    void insert(qint64 offset, const QByteArray& bytes);
+    void remove(qint64 offset, qint64 length);
+
+    bool isUndoAvailable() const;
+    bool isRedoAvailable() const;
+
+    // both return the offset of the restored change, or -1
+    qint64 undo();
+    qint64 redo();
+
+    // calls write(data, length) for every slice of the document, in order
+    template <typename Writer>
+    bool write(Writer writer) const;
+
+    static const int LineStride = 64;
+
+private:
+    enum Buffer {
+        Original,
+        Added
+    };
+
+    struct Piece {
+        Buffer buffer;
+        qint64 start;
+        qint64 length;
+        int newlines;
+    };
+
+    // the pieces from index were before, and are after the change
+    struct Change {
+        int index;
+        QVector<Piece> before;
+        QVector<Piece> after;
+        qint64 offset;
+    };
+
+    const char* data(const Piece& piece) const;
+    int newlinesIn(Buffer buffer, qint64 start, qint64 length) const;
+    qint64 nthNewline(Buffer buffer, qint64 start, int n) const;
+
+    // index of the piece holding offset (the piece count past the end)
+    // and the offset where it starts
+    int pieceAt(qint64 offset, qint64* pieceOffset) const;
+
+    // length bytes of piece, from its byte from
+    Piece slice(const Piece& piece, qint64 from, qint64 length) const;
+
+    // replaces count pieces from index with pieces
+    void replace(int index, int count, const QVector<Piece>& pieces);
+
+    // applies change, recording it for undo
+    void apply(const Change& change);
+
+    // original buffer
+    qint64 originalLineStart(int line) const;
+    int originalLineForOffset(qint64 offset) const;
+
+    const char* _original;
+    qint64 _originalSize;
+    QVector<qint64> _checkpoints;
+
+    QByteArray _added;
+    QVector<qint64> _addedNewlines;
+
+    QVector<Piece> _pieces;
+    qint64 _size;
+    int _newlines;
+
+    QList<Change> _undoStack;
+    QList<Change> _redoStack;
+
+    // typing goes on extending the last added piece, in one undo step
+    qint64 _typingOffset;
+};
+
+
+template <typename Writer>
+bool PieceTable::write(Writer writer) const
+{
+    for (const Piece& piece : _pieces) {
+        if (!writer(data(piece), piece.length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+#endif // PIECETABLE_H
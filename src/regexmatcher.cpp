@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "regexmatcher.h"
+
+#include <QElapsedTimer>
+
+
+RegexMatcher::RegexMatcher(const QString& text, const QRegularExpression& regex,
+                           bool replacing, const QString& replacement, QObject *parent)
+    : QObject(parent)
+    , _text(text)
+    , _regex(regex)
+    , _replacing(replacing)
+    , _replacement(replacement)
+    , _cancelled(0)
+{
+}
+
+
+void RegexMatcher::cancel()
+{
+    _cancelled.storeRelease(1);
+}
+
+
+QString RegexMatcher::expand(const QString& replacement, const QRegularExpressionMatch& match)
+{
+    QString result;
+    result.reserve(replacement.length());
+
+    const int length = replacement.length();
+    for (int i = 0; i < length; ++i) {
+        const QChar c = replacement.at(i);
+        if (c != QLatin1Char('\\') || i + 1 == length || !replacement.at(i + 1).isDigit()) {
+            result += c;
+            continue;
+        }
+
+        // two digits when there are so many groups, as QString::replace() does
+        int group = replacement.at(i + 1).digitValue();
+        ++i;
+        if (i + 1 < length && replacement.at(i + 1).isDigit()) {
+            const int twoDigits = group * 10 + replacement.at(i + 1).digitValue();
+            if (twoDigits <= match.lastCapturedIndex()) {
+                group = twoDigits;
+                ++i;
+            }
+        }
+        result += match.captured(group);
+    }
+    return result;
+}
+
+
+void RegexMatcher::match()
+{
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+
+    QVector<RegexMatch> batch;
+    QRegularExpressionMatchIterator it = _regex.globalMatch(_text);
+    while (it.hasNext()) {
+        if (_cancelled.loadAcquire()) {
+            Q_EMIT finished(false);
+            return;
+        }
+
+        const QRegularExpressionMatch found = it.next();
+        RegexMatch match = { found.capturedStart(), found.capturedLength(), QString() };
+        if (_replacing) {
+            match.replacement = expand(_replacement, found);
+        }
+        batch.append(match);
+
+        // the first matches are shown soon, the next ones in big batches
+        if (batch.size() == BatchSize || batchTimer.elapsed() >= BatchInterval) {
+            Q_EMIT matchesFound(batch);
+            batch.clear();
+            batchTimer.restart();
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        Q_EMIT matchesFound(batch);
+    }
+    Q_EMIT finished(true);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef REGEXMATCHER_H
+#define REGEXMATCHER_H
+
+
+#include <QAtomicInt>
+#include <QMetaType>
+#include <QObject>
+#include <QRegularExpression>
+#include <QVector>
+
+
+// a match, with its replacement when replacing
+struct RegexMatch {
+    int position;
+    int length;
+    QString replacement;
+};
+
+Q_DECLARE_METATYPE(RegexMatch)
+
+
+// Finds all the matches of a regular expression in a text.
+// It is meant to live in a worker thread: the matches are handed to
+// the GUI thread in batches, with the matchesFound() signal, while
+// matching goes on. A pattern can take very long to match: the GUI
+// never waits for the matcher, it can just cancel it.
+class RegexMatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    // with replacing, every match comes with replacement, where \0 to \99
+    // stand for the captured texts
+    RegexMatcher(const QString& text, const QRegularExpression& regex,
+                 bool replacing, const QString& replacement, QObject *parent = nullptr);
+
+    // thread safe, called from the GUI thread
+    void cancel();
+
+    // replacement, with the captured texts of match
+    static QString expand(const QString& replacement, const QRegularExpressionMatch& match);
+
+    // matches in a batch, at most
+    static const int BatchSize = 1000;
+    // time a batch waits for more matches, at most
+    static const int BatchInterval = 20;
+
+public Q_SLOTS:
+    void match();
+
+Q_SIGNALS:
+    void matchesFound(const QVector<RegexMatch>& matches);
+
+    // completed is false when matching has been cancelled
+    void finished(bool completed);
+
+private:
+    QString _text;
+    QRegularExpression _regex;
+
+    bool _replacing;
+    QString _replacement;
+
+    QAtomicInt _cancelled;
+};
+
+#endif // REGEXMATCHER_H
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "regexsearch.h"
+
+#include "textedit.h"
+
+#include <QTextCursor>
+#include <QThread>
+
+#include <algorithm>
+
+
+static bool positionLess(const RegexMatch& match, int position)
+{
+    return match.position < position;
+}
+
+
+RegexSearch::RegexSearch(TextEdit* editor)
+    : QObject(editor)
+    , _editor(editor)
+    , _thread(nullptr)
+    , _matcher(nullptr)
+    , _generation(0)
+    , _complete(false)
+    , _replacing(false)
+    , _request(NoRequest)
+    , _from(0)
+{
+    qRegisterMetaType<QVector<RegexMatch> >();
+}
+
+
+RegexSearch::~RegexSearch()
+{
+    stop();
+}
+
+
+bool RegexSearch::setPattern(const QString& pattern, Qt::CaseSensitivity cs)
+{
+    // ^ and $ match at line boundaries
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+    if (cs == Qt::CaseInsensitive) {
+        options |= QRegularExpression::CaseInsensitiveOption;
+    }
+
+    if (pattern != _regex.pattern() || options != _regex.patternOptions()) {
+        stop();
+        _text.clear();
+        _matches.clear();
+        _complete = false;
+
+        _regex = QRegularExpression(pattern, options);
+        if (_regex.isValid()) {
+            // compiled here, once: the matchers share it
+            _regex.optimize();
+        }
+    }
+
+    if (!_regex.isValid()) {
+        Q_EMIT invalidPattern(_regex.errorString());
+        return false;
+    }
+    return true;
+}
+
+
+void RegexSearch::find(const QString& pattern, QTextDocument::FindFlags flags)
+{
+    if (!setPattern(pattern, (flags & QTextDocument::FindCaseSensitively) ? Qt::CaseSensitive : Qt::CaseInsensitive)) {
+        return;
+    }
+
+    // a selection (e.g. the previous match) is skipped
+    const QTextCursor cur = _editor->textCursor();
+    if (flags & QTextDocument::FindBackward) {
+        _from = cur.selectionStart();
+        request(FindPrevious, false, QString());
+    } else {
+        _from = cur.selectionEnd();
+        request(FindNext, false, QString());
+    }
+}
+
+
+void RegexSearch::replaceAll(const QString& pattern, const QString& replacement, Qt::CaseSensitivity cs)
+{
+    if (setPattern(pattern, cs)) {
+        request(ReplaceAll, true, replacement);
+    }
+}
+
+
+bool RegexSearch::replacementFor(const QString& text, const QString& replacement, QString* replaced) const
+{
+    const QRegularExpressionMatch match = _regex.match(text, 0, QRegularExpression::NormalMatch, QRegularExpression::AnchoredMatchOption);
+    if (!match.hasMatch() || match.capturedLength() != text.length()) {
+        return false;
+    }
+
+    *replaced = RegexMatcher::expand(replacement, match);
+    return true;
+}
+
+
+void RegexSearch::cancel()
+{
+    _request = NoRequest;
+    stop();
+}
+
+
+void RegexSearch::request(Request request, bool replacing, const QString& replacement)
+{
+    _request = request;
+
+    // an edit makes a new snapshot: the matches we have (or are coming)
+    // are still good when it is the same buffer
+    const QString& text = _editor->searchSnapshot();
+    const bool sameText = (text.constData() == _text.constData()) && (_complete || _matcher);
+    const bool sameReplacements = !replacing || (_replacing && replacement == _replacement);
+    if (!sameText || !sameReplacements) {
+        start(text, replacing, replacement);
+    }
+
+    answer();
+}
+
+
+void RegexSearch::start(const QString& text, bool replacing, const QString& replacement)
+{
+    stop();
+
+    _text = text;
+    _matches.clear();
+    _complete = false;
+    _replacing = replacing;
+    _replacement = replacement;
+
+    _thread = new QThread;
+    _matcher = new RegexMatcher(_text, _regex, replacing, replacement);
+    _matcher->moveToThread(_thread);
+
+    // the signals of an abandoned matcher can still be in the event queue:
+    // the generation counter lets us recognize (and drop) them
+    const int generation = ++_generation;
+
+    connect(_thread, &QThread::started, _matcher, &RegexMatcher::match);
+    connect(_matcher, &RegexMatcher::matchesFound, this, [this, generation](const QVector<RegexMatch>& matches) {
+            if (generation == _generation) {
+                addMatches(matches);
+            }
+        }
+    );
+    connect(_matcher, &RegexMatcher::finished, this, [this, generation](bool completed) {
+            if (generation == _generation) {
+                matchingFinished(completed);
+            }
+        }
+    );
+
+    // nobody waits for the thread: it cleans up after itself
+    connect(_thread, &QThread::finished, _matcher, &QObject::deleteLater);
+    connect(_thread, &QThread::finished, _thread, &QObject::deleteLater);
+
+    _thread->start();
+}
+
+
+void RegexSearch::stop()
+{
+    if (!_matcher) {
+        return;
+    }
+
+    // the matcher lives until its thread finishes, after the current match
+    _matcher->cancel();
+    _thread->quit();
+
+    _matcher = nullptr;
+    _thread = nullptr;
+    ++_generation;
+}
+
+
+void RegexSearch::addMatches(const QVector<RegexMatch>& matches)
+{
+    _matches += matches;
+    answer();
+}
+
+
+void RegexSearch::matchingFinished(bool completed)
+{
+    _thread->quit();
+    _matcher = nullptr;
+    _thread = nullptr;
+
+    _complete = completed;
+    answer();
+}
+
+
+void RegexSearch::answer()
+{
+    if (_request == NoRequest) {
+        return;
+    }
+
+    // the document has been edited while matching: match it again
+    if (_editor->searchSnapshot().constData() != _text.constData()) {
+        request(_request, _replacing, _replacement);
+        return;
+    }
+
+    // empty matches (e.g. "^") can be replaced, but not selected: the
+    // searches step over them, so the cursor never stops on one (see find())
+    QVector<RegexMatch>::const_iterator begin = _matches.constBegin();
+    QVector<RegexMatch>::const_iterator end = _matches.constEnd();
+    QVector<RegexMatch>::const_iterator from = std::lower_bound(begin, end, _from, positionLess);
+
+    switch (_request) {
+    case FindNext:
+        for (QVector<RegexMatch>::const_iterator it = from; it != end; ++it) {
+            if (it->length > 0) {
+                _request = NoRequest;
+                select(*it);
+                Q_EMIT found(true, false);
+                return;
+            }
+        }
+        if (_complete) {
+            _request = NoRequest;
+            for (QVector<RegexMatch>::const_iterator it = begin; it != from; ++it) {
+                if (it->length > 0) {
+                    select(*it);
+                    Q_EMIT found(true, true);
+                    return;
+                }
+            }
+            Q_EMIT found(false, false);
+        }
+        return;
+
+    case FindPrevious:
+        // a match before _from can still come
+        if (from == end && !_complete) {
+            return;
+        }
+        for (QVector<RegexMatch>::const_iterator it = from; it != begin; ) {
+            --it;
+            if (it->length > 0) {
+                _request = NoRequest;
+                select(*it);
+                Q_EMIT found(true, false);
+                return;
+            }
+        }
+        if (_complete) {
+            _request = NoRequest;
+            for (QVector<RegexMatch>::const_iterator it = end; it != from; ) {
+                --it;
+                if (it->length > 0) {
+                    select(*it);
+                    Q_EMIT found(true, true);
+                    return;
+                }
+            }
+            Q_EMIT found(false, false);
+        }
+        return;
+
+    case ReplaceAll:
+        if (_complete) {
+            _request = NoRequest;
+
+            QVector<TextEdit::Edit> edits;
+            edits.reserve(_matches.size());
+            for (const RegexMatch& match : qAsConst(_matches)) {
+                TextEdit::Edit edit = { match.position, match.length, match.replacement };
+                edits.append(edit);
+            }
+            _editor->applyEdits(edits);
+            Q_EMIT replaced(edits.size());
+        }
+        return;
+
+    case NoRequest:
+        return;
+    }
+}
+
+
+void RegexSearch::select(const RegexMatch& match)
+{
+    QTextCursor cur(_editor->document());
+    cur.setPosition(match.position);
+    cur.setPosition(match.position + match.length, QTextCursor::KeepAnchor);
+    _editor->setTextCursor(cur);
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef REGEXSEARCH_H
+#define REGEXSEARCH_H
+
+
+#include <QObject>
+#include <QRegularExpression>
+#include <QTextDocument>
+#include <QVector>
+
+#include "regexmatcher.h"
+
+class QThread;
+class TextEdit;
+
+
+// Regular expression search and replace in a TextEdit.
+// The pattern is compiled (with JIT, where available) once and the
+// matches of a document snapshot are collected by a RegexMatcher in a
+// worker thread: requests are answered as soon as the matches they
+// need arrive, with the found() and replaced() signals. A new pattern
+// (or an edit) abandons the matcher still running, so a pattern taking
+// ages to match never blocks the editor.
+class RegexSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RegexSearch(TextEdit* editor);
+    ~RegexSearch();
+
+    // false (and invalidPattern() emitted) when pattern does not compile
+    bool setPattern(const QString& pattern, Qt::CaseSensitivity cs);
+
+    // selects the next (the previous, with FindBackward) match of pattern,
+    // restarting from the other end of the document when needed.
+    // Empty matches (e.g. of "^") cannot be selected, so they are skipped:
+    // a pattern matching just empty strings is not found (the cursor stays
+    // where it is), while Replace All replaces them
+    void find(const QString& pattern, QTextDocument::FindFlags flags);
+
+    // replaces all the matches of pattern, in a single undo step
+    void replaceAll(const QString& pattern, const QString& replacement, Qt::CaseSensitivity cs);
+
+    // when text is a whole match of the current pattern, sets replaced
+    // to replacement with its captured texts and returns true
+    bool replacementFor(const QString& text, const QString& replacement, QString* replaced) const;
+
+    // drops the pending request, abandoning the matcher
+    void cancel();
+
+Q_SIGNALS:
+    void found(bool found, bool restarted);
+    void replaced(int count);
+    void invalidPattern(const QString& error);
+
+private:
+    enum Request {
+        NoRequest,
+        FindNext,
+        FindPrevious,
+        ReplaceAll
+    };
+
+    void request(Request request, bool replacing, const QString& replacement);
+    void start(const QString& text, bool replacing, const QString& replacement);
+    void stop();
+
+    void addMatches(const QVector<RegexMatch>& matches);
+    void matchingFinished(bool completed);
+
+    // answers the pending request, if the matches it needs are there
+    void answer();
+    void select(const RegexMatch& match);
+
+    TextEdit* _editor;
+    QRegularExpression _regex;
+
+    QThread* _thread;
+    RegexMatcher* _matcher;
+    int _generation;
+
+    // the snapshot matched and its matches, sorted by position
+    QString _text;
+    QVector<RegexMatch> _matches;
+    bool _complete;
+    bool _replacing;
+    QString _replacement;
+
+    Request _request;
+    // where a find starts
+    int _from;
+};
+
+
+#endif // REGEXSEARCH_H
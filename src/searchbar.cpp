@@ -11,19 +11,28 @@
 
 #include <QCheckBox>
 #include <QHBoxLayout>
+#include <QHideEvent>
 #include <QLabel>
 #include <QLineEdit>
 #include <QPushButton>
+#include <QTimer>
 
 
 SearchBar::SearchBar(QWidget *parent)
     : QWidget(parent)
     , _findLineEdit( new QLineEdit(this) )
     , _caseCheckBox( new QCheckBox( tr("Match Case") , this) )
+    , _regexCheckBox( new QCheckBox( tr("Regular Expression") , this) )
     , _notFoundLabel( new QLabel(this) )
+    , _typingTimer( new QTimer(this) )
 {
     connect(_findLineEdit, &QLineEdit::returnPressed, this, &SearchBar::findForward);
 
+    _typingTimer->setSingleShot(true);
+    _typingTimer->setInterval(TypingDelay);
+    connect(_typingTimer, &QTimer::timeout, this, &SearchBar::typingFinished);
+    connect(_findLineEdit, &QLineEdit::textEdited, _typingTimer, QOverload<>::of(&QTimer::start));
+
     auto label = new QLabel( tr("Search for:"), this);
     label->setMinimumWidth(100);
 
@@ -48,6 +57,7 @@ SearchBar::SearchBar(QWidget *parent)
     layout->addWidget (nextButton);
     layout->addWidget (prevButton);
     layout->addWidget (_caseCheckBox);
+    layout->addWidget (_regexCheckBox);
     layout->addStretch();
     layout->addWidget (_notFoundLabel);
     layout->addStretch();
@@ -60,6 +70,7 @@ SearchBar::SearchBar(QWidget *parent)
     setTabOrder(_findLineEdit, nextButton);
     setTabOrder(nextButton, prevButton);
     setTabOrder(prevButton,_caseCheckBox);
+    setTabOrder(_caseCheckBox, _regexCheckBox);
 }
 
 
@@ -81,13 +92,20 @@ bool SearchBar::caseChecked()
 }
 
 
+bool SearchBar::regexChecked()
+{
+    return _regexCheckBox->isChecked();
+}
+
+
 void SearchBar::findBackward()
 {
     _notFoundLabel->clear();
 
     QString str = _findLineEdit->text();
     bool caseSensitive = _caseCheckBox->isChecked();
-    Q_EMIT search(str, false, caseSensitive);
+    bool regex = _regexCheckBox->isChecked();
+    Q_EMIT search(str, false, caseSensitive, regex);
 }
 
 
@@ -97,7 +115,19 @@ void SearchBar::findForward()
 
     QString str = _findLineEdit->text();
     bool caseSensitive = _caseCheckBox->isChecked();
-    Q_EMIT search(str, true, caseSensitive);
+    bool regex = _regexCheckBox->isChecked();
+    Q_EMIT search(str, true, caseSensitive, regex);
+}
+
+
+void SearchBar::typingFinished()
+{
+    _notFoundLabel->clear();
+
+    QString str = _findLineEdit->text();
+    bool caseSensitive = _caseCheckBox->isChecked();
+    bool regex = _regexCheckBox->isChecked();
+    Q_EMIT searchTyped(str, caseSensitive, regex);
 }
 
 
@@ -106,3 +136,13 @@ void SearchBar::searchMessage(const QString &msg)
     QString text = QLatin1String("<b>") + msg + QLatin1String("</b>");
     _notFoundLabel->setText(text);
 }
+
+
+void SearchBar::hideEvent(QHideEvent *event)
+{
+    // not when the whole window gets minimized
+    if (!event->spontaneous()) {
+        Q_EMIT closed();
+    }
+    QWidget::hideEvent(event);
+}
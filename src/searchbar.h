@@ -14,8 +14,10 @@
 #include <QWidget>
 
 class QCheckBox;
+class QHideEvent;
 class QLabel;
 class QLineEdit;
+class QTimer;
 
 
 class SearchBar : public QWidget
@@ -29,24 +31,45 @@ public:
     QString text();
 
     bool caseChecked();
+    bool regexChecked();
+
+    // half a frame: the search has the other half to be shown in time
+    static const int TypingDelay = 8;
 
 Q_SIGNALS:
     void search(const QString &search,
                 bool forward = true,
-                bool casesensitive = false);
+                bool casesensitive = false,
+                bool regex = false);
+
+    // the text has been edited, for find as you type
+    void searchTyped(const QString &search,
+                     bool casesensitive,
+                     bool regex);
+
+    // closed by the user, e.g. to stop highlighting the matches
+    void closed();
 
 public Q_SLOTS:
     void searchMessage(const QString & msg);
 
+protected:
+    void hideEvent(QHideEvent *event) override;
+
 private Q_SLOTS:
     void findBackward();
     void findForward();
+    void typingFinished();
 
 private:
     QLineEdit* _findLineEdit;
 
     QCheckBox* _caseCheckBox;
+    QCheckBox* _regexCheckBox;
     QLabel* _notFoundLabel;
+
+    // keystrokes coming close together make a single search
+    QTimer* _typingTimer;
 };
 
 #endif // SEARCHBAR_H
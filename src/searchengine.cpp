@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "searchengine.h"
+
+#include "simdtext.h"
+
+#include <cstring>
+
+
+// the units folding to folded, when they are just an ASCII pair.
+// Other letters fold from more units (e.g. the Kelvin sign is a 'k')
+static bool caseVariants(ushort folded, ushort* lower, ushort* upper)
+{
+    if (folded >= 0x80 || folded == 'k' || folded == 's') {
+        return false;
+    }
+
+    *lower = folded;
+    *upper = (folded >= 'a' && folded <= 'z') ? ushort(folded - 'a' + 'A') : folded;
+    return true;
+}
+
+
+// maximal suffix of needle for the (reversed when asked) unit order:
+// the index before it and its period
+static void maximalSuffix(const ushort* needle, int length, bool reversed, int* critical, int* period)
+{
+    int suffix = -1;
+    int j = 0;
+    int k = 1;
+    int p = 1;
+    while (j + k < length) {
+        const ushort a = needle[j + k];
+        const ushort b = needle[suffix + k];
+        if (reversed ? (a > b) : (a < b)) {
+            j += k;
+            k = 1;
+            p = j - suffix;
+        } else if (a == b) {
+            if (k != p) {
+                ++k;
+            } else {
+                j += p;
+                k = 1;
+            }
+        } else {
+            suffix = j;
+            j = suffix + 1;
+            k = p = 1;
+        }
+    }
+    *critical = suffix;
+    *period = p;
+}
+
+
+SearchEngine::SearchEngine()
+    : _cs(Qt::CaseSensitive)
+    , _anchored(false)
+    , _first(0)
+    , _firstAlt(0)
+    , _last(0)
+    , _lastAlt(0)
+    , _critical(-1)
+    , _period(1)
+    , _periodic(false)
+{
+}
+
+
+ushort SearchEngine::fold(ushort unit) const
+{
+    if (_cs == Qt::CaseSensitive) {
+        return unit;
+    }
+    if (unit < 0x80) {
+        return (unit >= 'A' && unit <= 'Z') ? ushort(unit - 'A' + 'a') : unit;
+    }
+    return QChar(unit).toCaseFolded().unicode();
+}
+
+
+void SearchEngine::setPattern(const QString& pattern, Qt::CaseSensitivity cs)
+{
+    if (pattern == _pattern && cs == _cs) {
+        return;
+    }
+
+    _pattern = pattern;
+    _cs = cs;
+
+    const int length = _pattern.length();
+    _needle.resize(length);
+    for (int i = 0; i < length; ++i) {
+        _needle[i] = fold(_pattern.at(i).unicode());
+    }
+    if (length == 0) {
+        _anchored = false;
+        return;
+    }
+
+    if (_cs == Qt::CaseSensitive) {
+        _anchored = true;
+        _first = _firstAlt = _needle.first();
+        _last = _lastAlt = _needle.last();
+    } else {
+        _anchored = caseVariants(_needle.first(), &_first, &_firstAlt) && caseVariants(_needle.last(), &_last, &_lastAlt);
+    }
+
+    // the critical factorization is the later of the two maximal suffixes
+    int critical;
+    int period;
+    int reversedCritical;
+    int reversedPeriod;
+    const ushort* needle = _needle.constData();
+    maximalSuffix(needle, length, false, &critical, &period);
+    maximalSuffix(needle, length, true, &reversedCritical, &reversedPeriod);
+    if (reversedCritical > critical) {
+        critical = reversedCritical;
+        period = reversedPeriod;
+    }
+
+    _critical = critical;
+    _periodic = (critical + 1 + period <= length) && std::memcmp(needle, needle + period, (critical + 1) * sizeof(ushort)) == 0;
+    _period = _periodic ? period : qMax(critical + 1, length - critical - 1) + 1;
+}
+
+
+qint64 SearchEngine::indexIn(const ushort* text, qint64 size, qint64 from) const
+{
+    const int length = _needle.size();
+    if (length == 0 || size < length) {
+        return -1;
+    }
+    from = qMax(from, qint64(0));
+
+    if (!_anchored) {
+        return twoWay(text, size, from);
+    }
+
+    int falseCandidates = 0;
+    qint64 position = from;
+    while (true) {
+        position = SimdText::findCandidate(text, size, position, length, _first, _firstAlt, _last, _lastAlt);
+        if (position < 0) {
+            return -1;
+        }
+        if (matchesAt(text, position)) {
+            return position;
+        }
+
+        // every false candidate costs a compare: many of them, and a
+        // plain (linear) scan is faster
+        if (++falseCandidates > MaxFalseCandidates && falseCandidates > (position - from) / 16) {
+            return twoWay(text, size, position + 1);
+        }
+        ++position;
+    }
+}
+
+
+qint64 SearchEngine::lastIndexIn(const ushort* text, qint64 size, qint64 from) const
+{
+    const int length = _needle.size();
+    if (length == 0 || size < length) {
+        return -1;
+    }
+
+    // forward searches over windows of text, going backward: the last
+    // match of the first window having some is the one
+    qint64 high = qMin(from, size - length);
+    while (high >= 0) {
+        const qint64 low = qMax(qint64(0), high - BackwardWindow + 1);
+
+        qint64 found = -1;
+        qint64 position = indexIn(text, high + length, low);
+        while (position >= 0) {
+            found = position;
+            position = indexIn(text, high + length, position + 1);
+        }
+        if (found >= 0) {
+            return found;
+        }
+
+        high = low - 1;
+    }
+    return -1;
+}
+
+
+bool SearchEngine::isMatchAt(const ushort* text, qint64 size, qint64 position) const
+{
+    const int length = _needle.size();
+    if (length == 0 || position < 0 || position + length > size) {
+        return false;
+    }
+
+    for (int i = 0; i < length; ++i) {
+        if (fold(text[position + i]) != _needle.at(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool SearchEngine::matchesAt(const ushort* text, qint64 position) const
+{
+    // the candidate has the right first and last units already
+    const int length = _needle.size();
+    if (_cs == Qt::CaseSensitive) {
+        return length <= 2 || std::memcmp(text + position + 1, _needle.constData() + 1, (length - 2) * sizeof(ushort)) == 0;
+    }
+
+    for (int i = 1; i < length - 1; ++i) {
+        if (fold(text[position + i]) != _needle.at(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Crochemore-Perrin Two-Way: the right part of the needle is compared
+// left to right, then the left part right to left; on a mismatch the
+// needle shifts by what has been matched (or by the period)
+qint64 SearchEngine::twoWay(const ushort* text, qint64 size, qint64 from) const
+{
+    const ushort* needle = _needle.constData();
+    const int length = _needle.size();
+
+    qint64 j = from;
+    if (_periodic) {
+        // the prefix already known to match, after a shift by the period
+        int memory = -1;
+        while (j <= size - length) {
+            int i = qMax(_critical, memory) + 1;
+            while (i < length && needle[i] == fold(text[i + j])) {
+                ++i;
+            }
+            if (i < length) {
+                j += i - _critical;
+                memory = -1;
+                continue;
+            }
+
+            i = _critical;
+            while (i > memory && needle[i] == fold(text[i + j])) {
+                --i;
+            }
+            if (i <= memory) {
+                return j;
+            }
+            j += _period;
+            memory = length - _period - 1;
+        }
+    } else {
+        while (j <= size - length) {
+            int i = _critical + 1;
+            while (i < length && needle[i] == fold(text[i + j])) {
+                ++i;
+            }
+            if (i < length) {
+                j += i - _critical;
+                continue;
+            }
+
+            i = _critical;
+            while (i >= 0 && needle[i] == fold(text[i + j])) {
+                --i;
+            }
+            if (i < 0) {
+                return j;
+            }
+            j += _period;
+        }
+    }
+    return -1;
+}
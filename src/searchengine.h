@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+
+#include <QString>
+#include <QVector>
+
+
+// Finds a pattern in flat UTF-16 text (e.g. a snapshot of a document).
+// The pattern is prepared once: case folded, with its anchor units and
+// its Two-Way factorization. Match candidates are filtered by their first
+// and last unit with the SimdText vector kernel; a pattern whose anchors
+// have no simple case variants, or giving too many false candidates,
+// is searched with Two-Way (linear in the worst case) instead.
+class SearchEngine
+{
+public:
+    SearchEngine();
+
+    void setPattern(const QString& pattern, Qt::CaseSensitivity cs);
+
+    inline QString pattern() const { return _pattern; };
+    inline Qt::CaseSensitivity caseSensitivity() const { return _cs; };
+
+    // the first match starting at or after from, -1 if none
+    qint64 indexIn(const ushort* text, qint64 size, qint64 from) const;
+
+    // the last match starting at or before from, -1 if none
+    qint64 lastIndexIn(const ushort* text, qint64 size, qint64 from) const;
+
+    // true when a match starts at position
+    bool isMatchAt(const ushort* text, qint64 size, qint64 position) const;
+
+    // false candidates allowed before going on with Two-Way
+    static const int MaxFalseCandidates = 64;
+
+    // text searched forward at a time by a backward search
+    static const int BackwardWindow = 64 * 1024;
+
+private:
+    ushort fold(ushort unit) const;
+    bool matchesAt(const ushort* text, qint64 position) const;
+    qint64 twoWay(const ushort* text, qint64 size, qint64 from) const;
+
+    QString _pattern;
+    Qt::CaseSensitivity _cs;
+
+    // the pattern, case folded when searching case insensitively
+    QVector<ushort> _needle;
+
+    // the units a match can start and end with, when they are few
+    bool _anchored;
+    ushort _first;
+    ushort _firstAlt;
+    ushort _last;
+    ushort _lastAlt;
+
+    // Two-Way critical factorization
+    int _critical;
+    int _period;
+    bool _periodic;
+};
+
+
+#endif // SEARCHENGINE_H
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "searchresultsmodel.h"
+
+
+SearchResultsModel::SearchResultsModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+
+int SearchResultsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : _results.size();
+}
+
+
+QVariant SearchResultsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= _results.size()) {
+        return QVariant();
+    }
+
+    const SearchResult& result = _results.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return result.source + QLatin1Char(':') + QString::number(result.line + 1) + QLatin1String(": ") + result.preview;
+    case Qt::ToolTipRole:
+        return result.source;
+    default:
+        return QVariant();
+    }
+}
+
+
+void SearchResultsModel::append(const QVector<SearchResult>& results)
+{
+    if (results.isEmpty()) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), _results.size(), _results.size() + results.size() - 1);
+    _results += results;
+    endInsertRows();
+}
+
+
+void SearchResultsModel::clear()
+{
+    beginResetModel();
+    _results.clear();
+    endResetModel();
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef SEARCHRESULTSMODEL_H
+#define SEARCHRESULTSMODEL_H
+
+
+#include <QAbstractListModel>
+#include <QMetaType>
+#include <QVector>
+
+
+// a match found searching many documents (or files)
+struct SearchResult {
+    QString source;     // where it has been found, as shown to the user
+    int document;       // index of the searched document, -1 for a file
+    int line;           // 0 based
+    int column;         // 0 based
+    int position;       // of the match in the document, in characters (-1 for a file)
+    int length;
+    QString preview;    // (part of) the line of the match
+};
+
+Q_DECLARE_METATYPE(SearchResult)
+
+
+// The results of a search, as "source:line: preview" rows.
+// Results come in batches, while searching; the view shows just
+// the rows on screen, so a model with many results costs just memory.
+class SearchResultsModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit SearchResultsModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void append(const QVector<SearchResult>& results);
+    void clear();
+
+    inline const SearchResult& result(int row) const { return _results.at(row); };
+
+private:
+    QVector<SearchResult> _results;
+};
+
+
+#endif // SEARCHRESULTSMODEL_H
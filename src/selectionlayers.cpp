@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "selectionlayers.h"
+
+#include <QPlainTextEdit>
+
+
+SelectionLayers::SelectionLayers(QPlainTextEdit* editor)
+    : _editor(editor)
+    , _layers(LayerCount)
+{
+}
+
+
+void SelectionLayers::setLayer(Layer layer, const QList<QTextEdit::ExtraSelection>& selections)
+{
+    // e.g. no occurrences before, none now
+    if (selections.isEmpty() && _layers.at(layer).isEmpty()) {
+        return;
+    }
+    _layers[layer] = selections;
+
+    QList<QTextEdit::ExtraSelection> all;
+    for (const QList<QTextEdit::ExtraSelection>& layerSelections : qAsConst(_layers)) {
+        all += layerSelections;
+    }
+    _editor->setExtraSelections(all);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef SELECTIONLAYERS_H
+#define SELECTIONLAYERS_H
+
+
+#include <QList>
+#include <QTextEdit>
+#include <QVector>
+
+class QPlainTextEdit;
+
+
+// The extra selections of an editor, kept as independent layers (the
+// current line, the occurrences of a text, the matching brackets): every
+// owner replaces just its own layer, when its input changes, and the
+// others are kept. QPlainTextEdit repaints just the selections that
+// changed, so the layers keep their cursors stable (e.g. the current line
+// is anchored at its start, not at the cursor moving along it).
+class SelectionLayers
+{
+public:
+    // from bottom to top
+    enum Layer {
+        CurrentLine,
+        Occurrences,
+        Brackets,
+        LayerCount
+    };
+
+    explicit SelectionLayers(QPlainTextEdit* editor);
+
+    void setLayer(Layer layer, const QList<QTextEdit::ExtraSelection>& selections);
+    inline QList<QTextEdit::ExtraSelection> layer(Layer layer) const { return _layers.at(layer); };
+
+private:
+    QPlainTextEdit* _editor;
+    QVector<QList<QTextEdit::ExtraSelection> > _layers;
+};
+
+
+#endif // SELECTIONLAYERS_H
@@ -25,6 +25,8 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     setWindowTitle( tr("Cutepad Settings") );
 
     ui->spacesSpinBox->setRange(1,12);
+    ui->largeFileSpinBox->setRange(1,65536);
+    ui->highlightingSpinBox->setRange(1,65536);
         
     connect(ui->lineColorButton, &QPushButton::clicked, this, &SettingsDialog::chooseHighlightColor);
     connect(ui->fontButton, &QPushButton::clicked, this, &SettingsDialog::chooseFont);
@@ -37,6 +39,8 @@ SettingsDialog::SettingsDialog(QWidget *parent)
 
     connect(ui->replaceTabsWithSpacesCheckBox, &QCheckBox::stateChanged, this, &SettingsDialog::saveSettings);
     connect(ui->spacesSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsDialog::saveSettings);
+    connect(ui->largeFileSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsDialog::saveSettings);
+    connect(ui->highlightingSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsDialog::saveSettings);
 }
 
 
@@ -68,6 +72,12 @@ void SettingsDialog::loadSettings()
 
     int tabsCount = s.value( QStringLiteral("TabsCount"), 4).toInt();
     ui->spacesSpinBox->setValue(tabsCount);
+
+    int largeFileThreshold = s.value( QStringLiteral("LargeFileThreshold"), 256).toInt();
+    ui->largeFileSpinBox->setValue(largeFileThreshold);
+
+    int highlightingThreshold = s.value( QStringLiteral("HighlightingThreshold"), 16).toInt();
+    ui->highlightingSpinBox->setValue(highlightingThreshold);
     
     // font
     QString fontFamily = s.value( QStringLiteral("fontFamily") , QStringLiteral("Monospace") ).toString();
@@ -104,6 +114,12 @@ void SettingsDialog::saveSettings()
     int tabsCount = ui->spacesSpinBox->value();
     s.setValue( QStringLiteral("TabsCount") , tabsCount);
 
+    int largeFileThreshold = ui->largeFileSpinBox->value();
+    s.setValue( QStringLiteral("LargeFileThreshold") , largeFileThreshold);
+
+    int highlightingThreshold = ui->highlightingSpinBox->value();
+    s.setValue( QStringLiteral("HighlightingThreshold") , highlightingThreshold);
+
     // font
     QFont f = ui->fontLabel->font();
     QString fontFamily = f.family();
@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "simdtext.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#  define SIMDTEXT_SSE2
+#  include <emmintrin.h>
+#  if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#    define SIMDTEXT_AVX2
+#    include <immintrin.h>
+#  endif
+#endif
+
+
+namespace SimdText
+{
+
+// ----------------------------------------------------------------------------------
+// ASCII scan
+
+
+#ifdef SIMDTEXT_AVX2
+__attribute__((target("avx2")))
+static qint64 asciiPrefixLengthAvx2(const char* data, qint64 size)
+{
+    qint64 i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        int mask = _mm256_movemask_epi8(chunk);
+        if (mask) {
+            return i + __builtin_ctz(unsigned(mask));
+        }
+    }
+    for (; i < size; ++i) {
+        if (static_cast<unsigned char>(data[i]) & 0x80) {
+            return i;
+        }
+    }
+    return size;
+}
+
+
+static bool hasAvx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+#endif
+
+
+#ifdef SIMDTEXT_SSE2
+static qint64 asciiPrefixLengthSse2(const char* data, qint64 size)
+{
+    qint64 i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int mask = _mm_movemask_epi8(chunk);
+        if (mask) {
+#ifdef __GNUC__
+            return i + __builtin_ctz(unsigned(mask));
+#else
+            int bit = 0;
+            while (!(mask & (1 << bit))) {
+                ++bit;
+            }
+            return i + bit;
+#endif
+        }
+    }
+    for (; i < size; ++i) {
+        if (static_cast<unsigned char>(data[i]) & 0x80) {
+            return i;
+        }
+    }
+    return size;
+}
+#endif
+
+
+#ifndef SIMDTEXT_SSE2
+static qint64 asciiPrefixLengthScalar(const char* data, qint64 size)
+{
+    // a word at a time
+    qint64 i = 0;
+    for (; i + 8 <= size; i += 8) {
+        quint64 word;
+        memcpy(&word, data + i, 8);
+        if (word & Q_UINT64_C(0x8080808080808080)) {
+            break;
+        }
+    }
+    for (; i < size; ++i) {
+        if (static_cast<unsigned char>(data[i]) & 0x80) {
+            return i;
+        }
+    }
+    return size;
+}
+#endif
+
+
+qint64 asciiPrefixLength(const char* data, qint64 size)
+{
+#ifdef SIMDTEXT_AVX2
+    if (hasAvx2()) {
+        return asciiPrefixLengthAvx2(data, size);
+    }
+#endif
+#ifdef SIMDTEXT_SSE2
+    return asciiPrefixLengthSse2(data, size);
+#else
+    return asciiPrefixLengthScalar(data, size);
+#endif
+}
+
+
+// ----------------------------------------------------------------------------------
+// UTF-8 validation
+
+
+// length of the valid multibyte sequence starting at data[0] (a non ASCII byte),
+// 0 if invalid, -1 if valid but truncated by the end of the buffer
+static int multibyteSequenceLength(const unsigned char* data, qint64 available)
+{
+    const unsigned char lead = data[0];
+
+    int length;
+    unsigned char min = 0x80;
+    unsigned char max = 0xBF;
+
+    // see the "Well-Formed UTF-8 Byte Sequences" table of the Unicode standard
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) {
+            min = 0xA0;     // overlong
+        } else if (lead == 0xED) {
+            max = 0x9F;     // surrogates
+        }
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) {
+            min = 0x90;     // overlong
+        } else if (lead == 0xF4) {
+            max = 0x8F;     // > U+10FFFF
+        }
+    } else {
+        return 0;
+    }
+
+    for (int i = 1; i < length; ++i) {
+        if (i >= available) {
+            return -1;
+        }
+        const unsigned char c = data[i];
+        if (i == 1 ? (c < min || c > max) : (c < 0x80 || c > 0xBF)) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+
+Utf8Result validateUtf8(const char* data, qint64 size, bool truncatedTail)
+{
+    // text is mostly ASCII, even when it is not all ASCII: skip the
+    // 7 bit runs with vector code and check the sequences in between
+    qint64 i = asciiPrefixLength(data, size);
+    if (i == size) {
+        return Ascii;
+    }
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    while (i < size) {
+        if (bytes[i] < 0x80) {
+            i += asciiPrefixLength(data + i, size - i);
+            continue;
+        }
+
+        int length = multibyteSequenceLength(bytes + i, size - i);
+        if (length == 0) {
+            return Invalid;
+        }
+        if (length < 0) {
+            return truncatedTail ? Utf8 : Invalid;
+        }
+        i += length;
+    }
+
+    return Utf8;
+}
+
+
+int incompleteUtf8Tail(const char* data, qint64 size)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    for (int k = 1; k <= 3 && k <= size; ++k) {
+        const unsigned char c = bytes[size - k];
+        if ((c & 0xC0) == 0x80) {
+            continue;   // continuation byte: look for its lead
+        }
+        if (c < 0xC0) {
+            return 0;
+        }
+        const int needed = c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : 2);
+        return needed > k ? k : 0;
+    }
+    return 0;
+}
+
+
+// ----------------------------------------------------------------------------------
+// decoding
+
+
+#ifdef SIMDTEXT_AVX2
+__attribute__((target("avx2")))
+static qint64 widenAsciiAvx2(const char* src, qint64 size, ushort* dst, bool stopAtNonAscii)
+{
+    qint64 i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (stopAtNonAscii && _mm256_movemask_epi8(chunk)) {
+            break;
+        }
+        __m256i low = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(chunk));
+        __m256i high = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(chunk, 1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 16), high);
+    }
+    return i;
+}
+#endif
+
+
+#ifdef SIMDTEXT_SSE2
+static qint64 widenAsciiSse2(const char* src, qint64 size, ushort* dst, bool stopAtNonAscii)
+{
+    const __m128i zero = _mm_setzero_si128();
+    qint64 i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (stopAtNonAscii && _mm_movemask_epi8(chunk)) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(chunk, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(chunk, zero));
+    }
+    return i;
+}
+#endif
+
+
+// widens whole vectors of src, stopping at the first one with a non ASCII
+// byte when asked to. Returns the bytes (and units) processed
+static qint64 widenVectors(const char* src, qint64 size, ushort* dst, bool stopAtNonAscii)
+{
+#ifdef SIMDTEXT_AVX2
+    if (hasAvx2()) {
+        return widenAsciiAvx2(src, size, dst, stopAtNonAscii);
+    }
+#endif
+#ifdef SIMDTEXT_SSE2
+    return widenAsciiSse2(src, size, dst, stopAtNonAscii);
+#else
+    Q_UNUSED(src)
+    Q_UNUSED(size)
+    Q_UNUSED(dst)
+    Q_UNUSED(stopAtNonAscii)
+    return 0;
+#endif
+}
+
+
+qint64 decodeUtf8(const char* src, qint64 size, ushort* dst)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(src);
+    qint64 i = 0;
+    qint64 out = 0;
+
+    while (i < size) {
+        if (bytes[i] < 0x80) {
+            // vectors of ASCII, then the ASCII bytes left before the next sequence
+            qint64 n = widenVectors(src + i, size - i, dst + out, true);
+            i += n;
+            out += n;
+            while (i < size && bytes[i] < 0x80) {
+                dst[out++] = bytes[i++];
+            }
+            continue;
+        }
+
+        int length = multibyteSequenceLength(bytes + i, size - i);
+        if (length <= 0) {
+            dst[out++] = 0xFFFD;
+            ++i;
+            continue;
+        }
+
+        const unsigned char* s = bytes + i;
+        uint ucs4;
+        switch (length) {
+        case 2:
+            ucs4 = ((s[0] & 0x1Fu) << 6) | (s[1] & 0x3Fu);
+            break;
+        case 3:
+            ucs4 = ((s[0] & 0x0Fu) << 12) | ((s[1] & 0x3Fu) << 6) | (s[2] & 0x3Fu);
+            break;
+        default:
+            ucs4 = ((s[0] & 0x07u) << 18) | ((s[1] & 0x3Fu) << 12) | ((s[2] & 0x3Fu) << 6) | (s[3] & 0x3Fu);
+            break;
+        }
+
+        if (ucs4 > 0xFFFF) {
+            dst[out++] = ushort(0xD7C0 + (ucs4 >> 10));
+            dst[out++] = ushort(0xDC00 + (ucs4 & 0x3FF));
+        } else {
+            dst[out++] = ushort(ucs4);
+        }
+        i += length;
+    }
+
+    return out;
+}
+
+
+void decodeLatin1(const char* src, qint64 size, ushort* dst)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(src);
+    for (qint64 i = widenVectors(src, size, dst, false); i < size; ++i) {
+        dst[i] = bytes[i];
+    }
+}
+
+
+
+// ----------------------------------------------------------------------------------
+// substring search
+
+
+#ifdef SIMDTEXT_AVX2
+__attribute__((target("avx2")))
+static qint64 findCandidateAvx2(const ushort* text, qint64 end, qint64 from, int length,
+                                ushort first, ushort firstAlt, ushort last, ushort lastAlt)
+{
+    const __m256i first1 = _mm256_set1_epi16(short(first));
+    const __m256i first2 = _mm256_set1_epi16(short(firstAlt));
+    const __m256i last1 = _mm256_set1_epi16(short(last));
+    const __m256i last2 = _mm256_set1_epi16(short(lastAlt));
+
+    qint64 i = from;
+    for (; i + 16 <= end; i += 16) {
+        __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i + length - 1));
+        __m256i heads = _mm256_or_si256(_mm256_cmpeq_epi16(head, first1), _mm256_cmpeq_epi16(head, first2));
+        __m256i tails = _mm256_or_si256(_mm256_cmpeq_epi16(tail, last1), _mm256_cmpeq_epi16(tail, last2));
+        int mask = _mm256_movemask_epi8(_mm256_and_si256(heads, tails));
+        if (mask) {
+            // two mask bits per unit
+            return i + __builtin_ctz(unsigned(mask)) / 2;
+        }
+    }
+    return i;
+}
+#endif
+
+
+#ifdef SIMDTEXT_SSE2
+static qint64 findCandidateSse2(const ushort* text, qint64 end, qint64 from, int length,
+                                ushort first, ushort firstAlt, ushort last, ushort lastAlt)
+{
+    const __m128i first1 = _mm_set1_epi16(short(first));
+    const __m128i first2 = _mm_set1_epi16(short(firstAlt));
+    const __m128i last1 = _mm_set1_epi16(short(last));
+    const __m128i last2 = _mm_set1_epi16(short(lastAlt));
+
+    qint64 i = from;
+    for (; i + 8 <= end; i += 8) {
+        __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + length - 1));
+        __m128i heads = _mm_or_si128(_mm_cmpeq_epi16(head, first1), _mm_cmpeq_epi16(head, first2));
+        __m128i tails = _mm_or_si128(_mm_cmpeq_epi16(tail, last1), _mm_cmpeq_epi16(tail, last2));
+        if (_mm_movemask_epi8(_mm_and_si128(heads, tails))) {
+            // the scalar loop finds which one
+            return i;
+        }
+    }
+    return i;
+}
+#endif
+
+
+// skips whole vectors of positions (up to end, excluded) without candidates.
+// Returns the position the scalar scan has to go on from
+static qint64 skipVectors(const ushort* text, qint64 end, qint64 from, int length,
+                          ushort first, ushort firstAlt, ushort last, ushort lastAlt)
+{
+#ifdef SIMDTEXT_AVX2
+    if (hasAvx2()) {
+        return findCandidateAvx2(text, end, from, length, first, firstAlt, last, lastAlt);
+    }
+#endif
+#ifdef SIMDTEXT_SSE2
+    return findCandidateSse2(text, end, from, length, first, firstAlt, last, lastAlt);
+#else
+    Q_UNUSED(text)
+    Q_UNUSED(end)
+    Q_UNUSED(length)
+    Q_UNUSED(first)
+    Q_UNUSED(firstAlt)
+    Q_UNUSED(last)
+    Q_UNUSED(lastAlt)
+    return from;
+#endif
+}
+
+
+qint64 findCandidate(const ushort* text, qint64 size, qint64 from, int length,
+                     ushort first, ushort firstAlt, ushort last, ushort lastAlt)
+{
+    // one past the last position a needle fits at
+    const qint64 end = size - length + 1;
+    if (length <= 0 || from >= end) {
+        return -1;
+    }
+
+    qint64 i = skipVectors(text, end, qMax(from, qint64(0)), length, first, firstAlt, last, lastAlt);
+    for (; i < end; ++i) {
+        const ushort head = text[i];
+        const ushort tail = text[i + length - 1];
+        if ((head == first || head == firstAlt) && (tail == last || tail == lastAlt)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+};
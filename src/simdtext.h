@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef SIMDTEXT_H
+#define SIMDTEXT_H
+
+
+#include <QtGlobal>
+
+
+// Vectorized (SSE2/AVX2, with a scalar fallback) text kernels.
+// The AVX2 code paths are chosen at runtime, when the CPU supports them.
+namespace SimdText
+{
+
+enum Utf8Result {
+    Ascii,      // 7 bit only: valid as UTF-8 and as any ASCII compatible codec
+    Utf8,       // valid UTF-8, with some multibyte sequence
+    Invalid     // not UTF-8
+};
+
+// length of the leading 7 bit run of data
+qint64 asciiPrefixLength(const char* data, qint64 size);
+
+// validates size bytes of UTF-8. When truncatedTail is true, data is
+// considered just the beginning of a bigger buffer, so an incomplete
+// sequence at its very end does not make it invalid
+Utf8Result validateUtf8(const char* data, qint64 size, bool truncatedTail = false);
+
+// number of bytes (0 to 3) of an incomplete sequence at the end of data:
+// a chunked decoder has to keep them for the next chunk
+int incompleteUtf8Tail(const char* data, qint64 size);
+
+// decodes UTF-8 to UTF-16, writing to dst (room for size units is enough);
+// an invalid byte becomes U+FFFD. Returns the units written
+qint64 decodeUtf8(const char* src, qint64 size, ushort* dst);
+
+// widens Latin-1 to UTF-16, writing size units to dst
+void decodeLatin1(const char* src, qint64 size, ushort* dst);
+
+// first position i (from or after from) where a needle of length units
+// could start in size units of text: text[i] is first or firstAlt and
+// text[i + length - 1] is last or lastAlt. The units in between still
+// have to be compared. Returns -1 when there is none
+qint64 findCandidate(const ushort* text, qint64 size, qint64 from, int length,
+                     ushort first, ushort firstAlt, ushort last, ushort lastAlt);
+
+};
+
+#endif // SIMDTEXT_H
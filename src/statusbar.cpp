@@ -11,59 +11,169 @@
 
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QProgressBar>
+#include <QPushButton>
+
+
+// pixels before every field
+static const int FieldSpacing = 12;
 
 
 StatusBar::StatusBar(QWidget *parent)
     : QWidget(parent)
-    , _langLabel(new QLabel(this))
-    , _posLabel(new QLabel(this))
-    , _codecLabel(new QLabel(this))
-    , _zoomLabel(new QLabel(this))
+    , _rowLabel(nullptr)
+    , _columnLabel(nullptr)
+    , _selectionLabel(new QLabel(this))
+    , _linesLabel(nullptr)
+    , _langLabel(nullptr)
+    , _codecLabel(nullptr)
+    , _zoomLabel(nullptr)
+    , _row(-1)
+    , _column(-1)
+    , _selection(0)
+    , _lines(-1)
+    , _jobLabel(new QLabel(this))
+    , _progressBar(new QProgressBar(this))
+    , _cancelButton(new QPushButton( tr("Cancel"), this))
 {
+    _progressBar->setRange(0, 100);
+    _progressBar->setMaximumWidth(200);
+    connect(_cancelButton, &QPushButton::clicked, this, &StatusBar::cancelRequested);
+
     // The UI
     auto layout = new QHBoxLayout;
     layout->setContentsMargins (0, 0, 0, 0);
-    layout->addWidget (_posLabel);
-    layout->addWidget (_langLabel);
-    layout->addWidget (_codecLabel);
-    layout->addWidget (_zoomLabel);
+    layout->setSpacing(0);
+    _rowLabel = addField(layout, tr("Row"));
+    _columnLabel = addField(layout, tr("Column"));
+    layout->addWidget (_selectionLabel);
+    _linesLabel = addField(layout, tr("Lines"));
+    _langLabel = addField(layout, tr("Language"));
+    _codecLabel = addField(layout, tr("Encoding"));
+    _zoomLabel = addField(layout, tr("Zoom"));
+    layout->addSpacing(FieldSpacing);
+    layout->addWidget (_jobLabel);
+    layout->addSpacing(FieldSpacing);
+    layout->addWidget (_progressBar);
+    layout->addSpacing(FieldSpacing);
+    layout->addWidget (_cancelButton);
     setLayout (layout);
+
+    _selectionLabel->setTextFormat(Qt::PlainText);
+    _selectionLabel->hide();
+
+    _jobLabel->setTextFormat(Qt::PlainText);
+    QFont bold = _jobLabel->font();
+    bold.setBold(true);
+    _jobLabel->setFont(bold);
+
+    hideProgress();
+}
+
+
+QLabel* StatusBar::addField(QHBoxLayout* layout, const QString& caption)
+{
+    QLabel* captionLabel = new QLabel(caption + QLatin1String(": "), this);
+    captionLabel->setTextFormat(Qt::PlainText);
+    QFont bold = captionLabel->font();
+    bold.setBold(true);
+    captionLabel->setFont(bold);
+
+    QLabel* valueLabel = new QLabel(this);
+    valueLabel->setTextFormat(Qt::PlainText);
+
+    layout->addSpacing(FieldSpacing);
+    layout->addWidget(captionLabel);
+    layout->addWidget(valueLabel);
+    return valueLabel;
 }
 
 
 void StatusBar::setLanguage(const QString& lang)
 {
-    QString msg;
-    msg += QLatin1String("&nbsp;&nbsp;<b>") + tr("Language") + QLatin1String(": </b>");
-    msg += lang;
-    _langLabel->setText(msg);
+    if (lang != _lang) {
+        _lang = lang;
+        _langLabel->setText(lang);
+    }
 }
 
 
 void StatusBar::setPosition(int row, int col)
 {
-    QString msg;
-    msg += QLatin1String("&nbsp;&nbsp;<b>") + tr("Row") + QLatin1String(": </b>");
-    msg += QString::number(row + 1);
-    msg += QLatin1String(", <b>") + tr("Column") + QLatin1String(": </b>");
-    msg += QString::number(col + 1);
-    _posLabel->setText(msg);
+    if (row != _row) {
+        _row = row;
+        _rowLabel->setText( QString::number(row + 1) );
+    }
+    if (col != _column) {
+        _column = col;
+        _columnLabel->setText( QString::number(col + 1) );
+    }
+}
+
+
+void StatusBar::setSelection(int length)
+{
+    if (length == _selection) {
+        return;
+    }
+    _selection = length;
+
+    if (length == 0) {
+        _selectionLabel->hide();
+        return;
+    }
+    _selectionLabel->setText( tr(" (%n selected)", "", length) );
+    _selectionLabel->show();
+}
+
+
+void StatusBar::setLineCount(int lines)
+{
+    if (lines != _lines) {
+        _lines = lines;
+        _linesLabel->setText( QString::number(lines) );
+    }
 }
 
 
 void StatusBar::setCodec(const QString& codec)
 {
-    QString msg;
-    msg += QLatin1String("&nbsp;&nbsp;<b>") + tr("Encoding") + QLatin1String(": </b>");
-    msg += codec;
-    _codecLabel->setText(msg);
+    if (codec != _codec) {
+        _codec = codec;
+        _codecLabel->setText(codec);
+    }
 }
 
 
 void StatusBar::setZoom(const QString& zoom)
 {
-    QString msg;
-    msg += QLatin1String("&nbsp;&nbsp;<b>") + tr("Zoom") + QLatin1String(": </b>");
-    msg += zoom;
-    _zoomLabel->setText(msg);
+    if (zoom != _zoom) {
+        _zoom = zoom;
+        _zoomLabel->setText(zoom);
+    }
+}
+
+
+void StatusBar::showProgress(const QString& job)
+{
+    _jobLabel->setText(job);
+    _progressBar->setValue(0);
+
+    _jobLabel->show();
+    _progressBar->show();
+    _cancelButton->show();
+}
+
+
+void StatusBar::setProgress(int percent)
+{
+    _progressBar->setValue(percent);
+}
+
+
+void StatusBar::hideProgress()
+{
+    _jobLabel->hide();
+    _progressBar->hide();
+    _cancelButton->hide();
 }
@@ -11,9 +11,13 @@
 #define STATUS_BAR_H
 
 
+#include <QString>
 #include <QWidget>
 
+class QHBoxLayout;
 class QLabel;
+class QProgressBar;
+class QPushButton;
 
 
 class StatusBar : public QWidget
@@ -23,16 +27,47 @@ class StatusBar : public QWidget
 public:
     explicit StatusBar(QWidget *parent = nullptr);
     
+    // the fields are plain text labels, set just when their value changes
     void setLanguage(const QString& lang);
     void setPosition(int row, int col);
+    // selected characters: none hides the field
+    void setSelection(int length);
+    void setLineCount(int lines);
     void setCodec(const QString& codec);
     void setZoom(const QString& zoom);
 
+    // progress of long running jobs (e.g. loading a big file)
+    void showProgress(const QString& job);
+    void setProgress(int percent);
+    void hideProgress();
+
+Q_SIGNALS:
+    void cancelRequested();
+
 private:
+    // a bold caption, followed by the label of its value
+    QLabel* addField(QHBoxLayout* layout, const QString& caption);
+
+    QLabel* _rowLabel;
+    QLabel* _columnLabel;
+    QLabel* _selectionLabel;
+    QLabel* _linesLabel;
     QLabel* _langLabel;
-    QLabel* _posLabel;
     QLabel* _codecLabel;
     QLabel* _zoomLabel;
+
+    // the values shown
+    int _row;
+    int _column;
+    int _selection;
+    int _lines;
+    QString _lang;
+    QString _codec;
+    QString _zoom;
+
+    QLabel* _jobLabel;
+    QProgressBar* _progressBar;
+    QPushButton* _cancelButton;
 };
 
 #endif
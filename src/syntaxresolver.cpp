@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "syntaxresolver.h"
+
+#include <KSyntaxHighlighting/Repository>
+
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QStringList>
+
+
+// a glob like *.cpp: what it matches depends on the suffix alone
+static bool isSuffixGlob(const QString& glob)
+{
+    if (!glob.startsWith( QLatin1String("*.") )) {
+        return false;
+    }
+    for (int i = 2; i < glob.length(); ++i) {
+        const QChar c = glob.at(i);
+        if (c == QLatin1Char('*') || c == QLatin1Char('?') || c == QLatin1Char('[')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+SyntaxResolver::SyntaxResolver(KSyntaxHighlighting::Repository* repository)
+    : _repository(repository)
+{
+    const QVector<KSyntaxHighlighting::Definition> definitions = _repository->definitions();
+    for (const KSyntaxHighlighting::Definition& def : definitions) {
+        _byLanguage.insert(def.name().toLower(), def);
+
+        const QVector<QString> globs = def.extensions();
+        for (const QString& glob : globs) {
+            if (!isSuffixGlob(glob)) {
+                _nameGlobs.append( QRegularExpression(QRegularExpression::wildcardToRegularExpression(glob)) );
+            }
+        }
+    }
+}
+
+
+KSyntaxHighlighting::Definition SyntaxResolver::definitionFor(const QString& path, const QString& head)
+{
+    const QString fileName = QFileInfo(path).fileName();
+    const QString sniffed = head.left(SniffLength);
+
+    KSyntaxHighlighting::Definition def = definitionForModeline(sniffed);
+    if (!def.isValid()) {
+        def = definitionForName(fileName);
+    }
+    if (!def.isValid()) {
+        def = definitionForShebang(sniffed);
+    }
+    if (!def.isValid()) {
+        def = definitionForMimeType(fileName, sniffed);
+    }
+    return def;
+}
+
+
+KSyntaxHighlighting::Definition SyntaxResolver::definitionForName(const QString& fileName)
+{
+    if (fileName.isEmpty()) {
+        return KSyntaxHighlighting::Definition();
+    }
+
+    QHash<QString, KSyntaxHighlighting::Definition>::const_iterator cached = _byName.constFind(fileName);
+    if (cached != _byName.constEnd()) {
+        return cached.value();
+    }
+
+    KSyntaxHighlighting::Definition def;
+    bool byName = false;
+    for (const QRegularExpression& glob : qAsConst(_nameGlobs)) {
+        if (glob.match(fileName).hasMatch()) {
+            byName = true;
+            break;
+        }
+    }
+
+    // the globs like *.ext matching a name are the same for all the names
+    // with its complete suffix (there are no dots before it): a name without
+    // dots has none
+    const int dot = fileName.indexOf(QLatin1Char('.'));
+    if (byName) {
+        def = _repository->definitionForFileName(fileName);
+    } else if (dot >= 0) {
+        const QString suffix = fileName.mid(dot + 1);
+        cached = _bySuffix.constFind(suffix);
+        if (cached != _bySuffix.constEnd()) {
+            def = cached.value();
+        } else {
+            def = _repository->definitionForFileName(fileName);
+            _bySuffix.insert(suffix, def);
+        }
+    }
+
+    _byName.insert(fileName, def);
+    return def;
+}
+
+
+KSyntaxHighlighting::Definition SyntaxResolver::definitionForModeline(const QString& head)
+{
+    // vim: set ft=python :
+    static const QRegularExpression vim( QStringLiteral("(?:^|\\s)(?:vi|vim|ex):.*\\b(?:ft|filetype|syn|syntax)=([\\w+.-]+)") );
+    // -*- mode: python; coding: utf-8 -*-
+    static const QRegularExpression emacsMode( QStringLiteral("-\\*-.*\\bmode:\\s*([\\w+.-]+).*-\\*-") );
+    // -*- python -*-
+    static const QRegularExpression emacs( QStringLiteral("-\\*-\\s*([\\w+.-]+)\\s*-\\*-") );
+    // kate: hl C++;
+    static const QRegularExpression kate( QStringLiteral("kate:.*\\b(?:hl|syntax)\\s+([^;]+);") );
+
+    // a cheap test first: most of the files have no modeline
+    if (!head.contains( QLatin1String("vi") ) && !head.contains( QLatin1String("ex:") )
+            && !head.contains( QLatin1String("-*-") ) && !head.contains( QLatin1String("kate:") )) {
+        return KSyntaxHighlighting::Definition();
+    }
+
+    const QVector<QStringRef> lines = head.splitRef(QLatin1Char('\n'));
+    for (const QStringRef& line : lines) {
+        for (const QRegularExpression* modeline : { &vim, &emacsMode, &emacs, &kate }) {
+            const QRegularExpressionMatch match = modeline->match(line);
+            if (match.hasMatch()) {
+                const KSyntaxHighlighting::Definition def = definitionForLanguage(match.captured(1).trimmed());
+                if (def.isValid()) {
+                    return def;
+                }
+            }
+        }
+    }
+    return KSyntaxHighlighting::Definition();
+}
+
+
+KSyntaxHighlighting::Definition SyntaxResolver::definitionForShebang(const QString& head)
+{
+    if (!head.startsWith( QLatin1String("#!") )) {
+        return KSyntaxHighlighting::Definition();
+    }
+
+    // #!/bin/sh -e, #!/usr/bin/env python3
+    const QString line = head.mid(2, head.indexOf(QLatin1Char('\n')) - 2);
+    const QStringList words = line.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    if (words.isEmpty()) {
+        return KSyntaxHighlighting::Definition();
+    }
+
+    QString interpreter = QFileInfo(words.first()).fileName();
+    if (interpreter == QLatin1String("env")) {
+        interpreter.clear();
+        for (int i = 1; i < words.size(); ++i) {
+            // env options and variables
+            if (!words.at(i).startsWith(QLatin1Char('-')) && !words.at(i).contains(QLatin1Char('='))) {
+                interpreter = words.at(i);
+                break;
+            }
+        }
+    }
+    return definitionForLanguage(interpreter.trimmed());
+}
+
+
+KSyntaxHighlighting::Definition SyntaxResolver::definitionForMimeType(const QString& fileName, const QString& head)
+{
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFileNameAndData(fileName, head.toUtf8());
+    if (!mime.isValid() || mime.isDefault()) {
+        return KSyntaxHighlighting::Definition();
+    }
+
+    QHash<QString, KSyntaxHighlighting::Definition>::const_iterator cached = _byMimeType.constFind(mime.name());
+    if (cached != _byMimeType.constEnd()) {
+        return cached.value();
+    }
+
+    const KSyntaxHighlighting::Definition def = _repository->definitionForMimeType(mime.name());
+    _byMimeType.insert(mime.name(), def);
+    return def;
+}
+
+
+KSyntaxHighlighting::Definition SyntaxResolver::definitionForLanguage(const QString& name)
+{
+    // interpreters and editor file types named differently
+    static const QHash<QString, QString> aliases = {
+        { QStringLiteral("sh"), QStringLiteral("bash") },
+        { QStringLiteral("dash"), QStringLiteral("bash") },
+        { QStringLiteral("ksh"), QStringLiteral("bash") },
+        { QStringLiteral("node"), QStringLiteral("javascript") },
+        { QStringLiteral("nodejs"), QStringLiteral("javascript") },
+        { QStringLiteral("cpp"), QStringLiteral("c++") },
+        { QStringLiteral("make"), QStringLiteral("makefile") },
+        { QStringLiteral("gmake"), QStringLiteral("makefile") },
+        { QStringLiteral("php"), QStringLiteral("php/php") },
+        { QStringLiteral("tclsh"), QStringLiteral("tcl/tk") },
+        { QStringLiteral("wish"), QStringLiteral("tcl/tk") },
+        { QStringLiteral("gawk"), QStringLiteral("awk") },
+        { QStringLiteral("mawk"), QStringLiteral("awk") },
+    };
+
+    if (name.isEmpty()) {
+        return KSyntaxHighlighting::Definition();
+    }
+
+    // python3.9 is python
+    QString language = name.toLower();
+    for (int pass = 0; pass < 2; ++pass) {
+        const QString alias = aliases.value(language, language);
+        QHash<QString, KSyntaxHighlighting::Definition>::const_iterator found = _byLanguage.constFind(alias);
+        if (found != _byLanguage.constEnd()) {
+            return found.value();
+        }
+
+        int end = language.length();
+        while (end > 0 && (language.at(end - 1).isDigit() || language.at(end - 1) == QLatin1Char('.'))) {
+            --end;
+        }
+        if (end == language.length() || end == 0) {
+            break;
+        }
+        language.truncate(end);
+    }
+
+    // e.g. vim file types named as the suffix (ft=cs)
+    return definitionForName(QStringLiteral("modeline.") + name);
+}
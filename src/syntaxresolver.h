@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef SYNTAXRESOLVER_H
+#define SYNTAXRESOLVER_H
+
+
+#include <KSyntaxHighlighting/Definition>
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+namespace KSyntaxHighlighting {
+class Repository;
+}
+
+
+// Finds the syntax definition of a file, caching what it finds.
+// Most of the file names are resolved by their suffix alone: the
+// repository glob matching runs once per suffix (or per name, for the
+// few names with globs of their own, like CMakeLists.txt).
+// A modeline in the first lines wins over the name; files unknown by
+// name are recognized by their shebang, then by their MIME type.
+class SyntaxResolver
+{
+public:
+    explicit SyntaxResolver(KSyntaxHighlighting::Repository* repository);
+
+    // head is the beginning of the text: SniffLength characters are enough
+    KSyntaxHighlighting::Definition definitionFor(const QString& path, const QString& head);
+
+    static const int SniffLength = 512;
+
+private:
+    KSyntaxHighlighting::Definition definitionForName(const QString& fileName);
+    KSyntaxHighlighting::Definition definitionForModeline(const QString& head);
+    KSyntaxHighlighting::Definition definitionForShebang(const QString& head);
+    KSyntaxHighlighting::Definition definitionForMimeType(const QString& fileName, const QString& head);
+
+    // a definition named name, ignoring case and a few aliases (e.g. sh)
+    KSyntaxHighlighting::Definition definitionForLanguage(const QString& name);
+
+    KSyntaxHighlighting::Repository* _repository;
+
+    // the definitions by lower case name
+    QHash<QString, KSyntaxHighlighting::Definition> _byLanguage;
+
+    // globs matching more than a suffix (e.g. Makefile*)
+    QVector<QRegularExpression> _nameGlobs;
+
+    QHash<QString, KSyntaxHighlighting::Definition> _bySuffix;
+    QHash<QString, KSyntaxHighlighting::Definition> _byName;
+    QHash<QString, KSyntaxHighlighting::Definition> _byMimeType;
+};
+
+
+#endif // SYNTAXRESOLVER_H
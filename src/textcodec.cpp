@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#include "textcodec.h"
+
+#include "simdtext.h"
+
+#include <QTextCodec>
+
+#include <QDebug>
+
+
+namespace TextCodec
+{
+
+// bytes checked to tell UTF-8 from locale text: a bigger buffer is sampled
+static const int Utf8SampleSize = 16 * 1024 * 1024;
+
+
+QTextCodec* codecForByteArray(const QByteArray & bytes, bool verbose)
+{
+    // use first 16 bytes max to allow BOM detection of codec
+    QByteArray bom(bytes.data(), qMin(16, bytes.size()));
+    QTextCodec *codecForBOM = QTextCodec::codecForUtfText(bom, nullptr);
+    if (codecForBOM) {
+        if (verbose) {
+            qDebug() << "Codec for BOM:" << codecForBOM->name();
+        }
+        return codecForBOM;
+    }
+
+    QTextCodec *codecForHTML = QTextCodec::codecForHtml(bytes, nullptr);
+    if (codecForHTML) {
+        if (verbose) {
+            qDebug() << "Codec for HTML: " << codecForHTML->name();
+        }
+        return codecForHTML;
+    }
+    
+    // no BOM, no meta: is it UTF-8 (or plain ASCII)?
+    // the buffer can be the first chunk of a file (and a sample is surely
+    // just a part of it), so a truncated sequence at its end is fine
+    const int size = qMin(bytes.size(), Utf8SampleSize);
+    SimdText::Utf8Result result = SimdText::validateUtf8(bytes.constData(), size, true);
+
+    if (result == SimdText::Utf8) {
+        if (verbose) {
+            qDebug() << "Codec for UTF-8 content";
+        }
+        return QTextCodec::codecForName("UTF-8");
+    }
+
+    // ASCII is good for (almost) any locale codec
+    if (verbose) {
+        qDebug() << "Codec for locale";
+    }
+    return QTextCodec::codecForLocale();
+}
+
+
+QString encode(const QString& content, QTextCodec* fromCodec, QTextCodec* toCodec)
+{
+    if (fromCodec == toCodec) {
+        return content;
+    }
+    
+    QByteArray encodedData = fromCodec->fromUnicode(content);
+    QTextCodec::ConverterState state;
+    QString decodedString = toCodec->toUnicode(encodedData.constData(), encodedData.size(), &state);
+    return decodedString;    
+}
+
+};
@@ -1,43 +1,32 @@
+/*
+ * Copyright (C) Andrea Diamantini 2020-2021 <adjam@protonmail.com>
+ *
+ * CutePad project
+ *
+ * @license GPL-3.0 <https://www.gnu.org/licenses/gpl-3.0.txt>
+ */
+
+
+#ifndef TEXTCODEC_H
+#define TEXTCODEC_H
+
 
-#include <QTextCodec>
 #include <QByteArray>
+#include <QString>
+
+class QTextCodec;
 
-#include <QDebug>
 
 namespace TextCodec
 {
 
-QTextCodec* codecForByteArray(const QByteArray & bytes)
-{
-    // use first 16 bytes max to allow BOM detection of codec
-    QByteArray bom(bytes.data(), qMin(16, bytes.size()));
-    QTextCodec *codecForBOM = QTextCodec::codecForUtfText(bom, nullptr);
-    if (codecForBOM) {
-        qDebug() << "Codec for BOM:" << codecForBOM->name();
-        return codecForBOM;
-    }
-
-    QTextCodec *codecForHTML = QTextCodec::codecForHtml(bytes, nullptr);
-    if (codecForHTML) {
-        qDebug() << "Codec for HTML: " << codecForHTML->name();
-        return codecForHTML;
-    }
-    
-    qDebug() << "Codec for locale";
-    return QTextCodec::codecForLocale();
-}
-
-
-QString encode(const QString& content, QTextCodec* fromCodec, QTextCodec* toCodec)
-{
-    if (fromCodec == toCodec) {
-        return content;
-    }
-    
-    QByteArray encodedData = fromCodec->fromUnicode(content);
-    QTextCodec::ConverterState state;
-    QString decodedString = toCodec->toUnicode(encodedData.constData(), encodedData.size(), &state);
-    return decodedString;    
-}
+// guess the codec of some bytes (BOM, then HTML meta, then UTF-8 validation, then locale).
+// With verbose, how it has been guessed goes to the debug output
+QTextCodec* codecForByteArray(const QByteArray & bytes, bool verbose = true);
+
+// re-interpret content, written with fromCodec, as it was written with toCodec
+QString encode(const QString& content, QTextCodec* fromCodec, QTextCodec* toCodec);
 
 };
+
+#endif // TEXTCODEC_H
@@ -10,32 +10,70 @@
 
 #include "textedit.h"
 
+#include "application.h"
+#include "fileloader.h"
+#include "lazyhighlighter.h"
+#include "lineindex.h"
+#include "occurrencehighlighter.h"
+#include "regexsearch.h"
+#include "syntaxresolver.h"
 #include "textcodec.h"
 
 #include <KSyntaxHighlighting/Definition>
+#include <KSyntaxHighlighting/Repository>
 #include <KSyntaxHighlighting/Theme>
 
 #include <QMessageBox>
 #include <QPainter>
 #include <QTextBlock>
 #include <QTextCodec>
-#include <QTextStream>
+#include <QThread>
 
 #include <QDebug>
 
+#include <limits>
+
 
 TextEdit::TextEdit(QWidget *parent)
     : QPlainTextEdit(parent)
-    , _highlighter(new KSyntaxHighlighting::SyntaxHighlighter(this->document()))
-    , _highlightRepo(new KSyntaxHighlighting::Repository)
+    , _highlighter(new LazyHighlighter(this))
+    , _highlightingThreshold(std::numeric_limits<qint64>::max())
+    , _highlightingForced(false)
     , _lineNumberArea(nullptr)
+    , _digitWidth(0)
+    , _digitHeight(0)
     , _lineNumbersMode(0)
     , _highlight(false)
+    , _selectionLayers(this)
+    , _currentLineStart(-1)
+    , _bracketPosition(-1)
+    , _bracketRevision(-1)
     , _tabReplace(false)
     , _textCodec( QTextCodec::codecForLocale() )
+    , _lineIndex(new LineIndex(document()))
+    , _occurrences(new OccurrenceHighlighter(this))
+    , _regexSearch(new RegexSearch(this))
+    , _loaderThread(nullptr)
+    , _loader(nullptr)
+    , _loadGeneration(0)
+    , _saverThread(nullptr)
+    , _saver(nullptr)
+    , _savedRevision(-1)
+    , _saveGeneration(0)
 {
-    KSyntaxHighlighting::Theme theme = _highlightRepo->themeForPalette(this->palette());
-    _highlighter->setTheme(theme);
+    _occurrences->setSyntaxHighlighter(_highlighter);
+    connect(_occurrences, &OccurrenceHighlighter::selectionsChanged, this, &TextEdit::updateOccurrences);
+    connect(this, &TextEdit::cursorPositionChanged, this, &TextEdit::updateCursorSelections);
+    connect(document(), &QTextDocument::contentsChange, this, &TextEdit::updateSearchSnapshot);
+}
+
+
+TextEdit::~TextEdit()
+{
+    stopLoader();
+
+    // never lose a save in progress
+    waitForSaver();
 }
 
 
@@ -44,39 +82,204 @@ void TextEdit::loadFilePath(const QString & path)
     QFile file(path);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         QMessageBox::warning(this, tr("Error"), tr("Cannot open file. Not readable") );
+        Q_EMIT loadFinished(false);
         return;
     }
+    file.close();
+
+    // a new load wins over the one (eventually) running
+    stopLoader();
+
+    _loadingPath = path;
+    _highlighter->setDefinition(KSyntaxHighlighting::Definition());
+    _suspendedDefinition = KSyntaxHighlighting::Definition();
+    _highlightingForced = false;
+    _syntaxPath.clear();
+    _language.clear();
+
+    // chunks are appended while loading: they have not to be undoable
+    // and the user has not to edit a half loaded document
+    setPlainText(QString());
+    document()->setUndoRedoEnabled(false);
+    setReadOnly(true);
+
+    _loaderThread = new QThread;
+    _loader = new FileLoader(path);
+    _loader->moveToThread(_loaderThread);
+
+    // stale signals of a stopped loader can still be in the event queue:
+    // the generation counter lets us recognize (and drop) them
+    const int generation = ++_loadGeneration;
+
+    connect(_loaderThread, &QThread::started, _loader, &FileLoader::load);
+    connect(_loader, &FileLoader::codecDetected, this, [this, generation](const QByteArray& codecName) {
+            if (generation == _loadGeneration) {
+                _textCodec = QTextCodec::codecForName(codecName);
+            }
+        }
+    );
+    connect(_loader, &FileLoader::textDecoded, this, [this, generation](const QString& text) {
+            if (generation == _loadGeneration) {
+                appendLoadedText(text);
+            }
+        }
+    );
+    connect(_loader, &FileLoader::progress, this, [this, generation](int percent) {
+            if (generation == _loadGeneration) {
+                Q_EMIT loadProgress(percent);
+            }
+        }
+    );
+    connect(_loader, &FileLoader::finished, this, [this, generation](bool completed) {
+            if (generation == _loadGeneration) {
+                loadingFinished(completed);
+            }
+        }
+    );
+
+    _loaderThread->start();
+    Q_EMIT loadStarted();
+}
+
+
+void TextEdit::cancelLoading()
+{
+    if (_loader) {
+        _loader->cancel();
+    }
+}
+
+
+void TextEdit::appendLoadedText(const QString & text)
+{
+    QTextCursor cur(document());
+    cur.movePosition(QTextCursor::End);
+    cur.insertText(text);
 
-    QByteArray bytes = file.readAll();
-    _textCodec = TextCodec::codecForByteArray(bytes);
+    _loader->chunkConsumed();
+}
+
+
+void TextEdit::loadingFinished(bool completed)
+{
+    stopLoader();
+
+    document()->setUndoRedoEnabled(true);
+    setReadOnly(false);
+
+    if (!completed) {
+        qDebug() << "loading of" << _loadingPath << "cancelled";
+        setPlainText(QString());
+        _textCodec = QTextCodec::codecForLocale();
+        Q_EMIT loadFinished(false);
+        return;
+    }
 
-    QTextCodec::ConverterState state;
-    QString fileText = _textCodec->toUnicode(bytes.constData(), bytes.size(), &state);
-    setPlainText(fileText);
+    moveCursor(QTextCursor::Start);
 
-    syntaxHighlightForFile(path);
+    // the tabs are checked by the window, once it journals the edits
+    syntaxHighlightForFile(_loadingPath);
     updateLineNumbersMode();
-    checkTabSpaceReplacementNeeded();
+
+    Q_EMIT loadFinished(true);
+}
+
+
+void TextEdit::stopLoader()
+{
+    if (!_loader) {
+        return;
+    }
+
+    _loader->cancel();
+    _loaderThread->quit();
+    _loaderThread->wait();
+
+    delete _loader;
+    delete _loaderThread;
+    _loader = nullptr;
+    _loaderThread = nullptr;
 }
 
 
 void TextEdit::saveFilePath(const QString & path)
 {
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::critical(this, tr("Error"), tr("Cannot save file. Not writable") );
+    // one save at a time
+    waitForSaver();
+
+    // the snapshot (shared with the searches, not copied): the user
+    // can go on editing while it is written
+    _savingPath = path;
+    _savedRevision = document()->revision();
+
+    _saverThread = new QThread;
+    _saver = new FileSaver(path, searchSnapshot(), _textCodec);
+    _saver->moveToThread(_saverThread);
+
+    connect(_saverThread, &QThread::started, _saver, &FileSaver::save);
+    connect(_saver, &FileSaver::progress, this, &TextEdit::saveProgress);
+    const int generation = ++_saveGeneration;
+    connect(_saver, &FileSaver::finished, this, [this, generation](FileSaver::Result result) {
+            if (generation == _saveGeneration) {
+                savingFinished(result);
+            }
+        }
+    );
+
+    _saverThread->start();
+}
+
+
+bool TextEdit::hasChangedSinceSave()
+{
+    return document()->revision() != _savedRevision;
+}
+
+
+void TextEdit::cancelSaving()
+{
+    if (_saver) {
+        _saver->cancel();
+    }
+}
+
+
+void TextEdit::savingFinished(FileSaver::Result result)
+{
+    waitForSaver();
+
+    // a cancelled save is no error: the user asked for it
+    if (result != FileSaver::Saved) {
+        if (result == FileSaver::Failed) {
+            QMessageBox::critical(this, tr("Error"), tr("Cannot save file. Not writable") );
+        }
+        Q_EMIT saveFinished(false);
         return;
     }
 
-    QString content = toPlainText();
-    QByteArray encodedString = _textCodec->fromUnicode(content);
+    // same name, same syntax
+    if (_savingPath != _syntaxPath) {
+        syntaxHighlightForFile(_savingPath);
+        updateLineNumbersMode();
+    }
 
-    QTextStream out(&file);
-    out << encodedString;
-    file.close();
+    Q_EMIT saveFinished(true);
+}
 
-    syntaxHighlightForFile(path);
-    updateLineNumbersMode();
+
+void TextEdit::waitForSaver()
+{
+    if (!_saver) {
+        return;
+    }
+
+    _saverThread->quit();
+    _saverThread->wait();
+
+    delete _saver;
+    delete _saverThread;
+    _saver = nullptr;
+    _saverThread = nullptr;
 }
 
 
@@ -101,19 +304,226 @@ void TextEdit::encode(QTextCodec* targetCodec)
 }
 
 
+void TextEdit::applyEdits(const QVector<Edit>& edits)
+{
+    if (edits.isEmpty()) {
+        return;
+    }
+
+    // backwards, so the positions still to apply are not moved.
+    // Layout and highlighting follow the edit block just once
+    QTextCursor cur(document());
+    cur.beginEditBlock();
+    for (int i = edits.size() - 1; i >= 0; --i) {
+        const Edit& edit = edits.at(i);
+        cur.setPosition(edit.position);
+        cur.setPosition(edit.position + edit.length, QTextCursor::KeepAnchor);
+        cur.insertText(edit.text);
+    }
+    cur.endEditBlock();
+}
+
+
+bool TextEdit::findText(const QString & text, QTextDocument::FindFlags flags)
+{
+    if (text.isEmpty()) {
+        return false;
+    }
+
+    _searchEngine.setPattern(text, (flags & QTextDocument::FindCaseSensitively) ? Qt::CaseSensitive : Qt::CaseInsensitive);
+    const QString& content = searchSnapshot();
+    const ushort* data = content.utf16();
+
+    // a selection (e.g. the previous match) is skipped
+    const QTextCursor cur = textCursor();
+    qint64 position;
+    if (flags & QTextDocument::FindBackward) {
+        const int start = cur.selectionStart();
+        position = (start > 0) ? _searchEngine.lastIndexIn(data, content.size(), start - 1) : -1;
+    } else {
+        position = _searchEngine.indexIn(data, content.size(), cur.selectionEnd());
+    }
+
+    if (position < 0) {
+        return false;
+    }
+
+    selectRange(int(position), text.length());
+    return true;
+}
+
+
+bool TextEdit::findAsYouType(const QString & text, Qt::CaseSensitivity cs, bool* restarted)
+{
+    const qint64 position = _incrementalSearch.find(searchSnapshot(), text, cs, textCursor().selectionStart(), restarted);
+    if (position < 0) {
+        return false;
+    }
+
+    selectRange(int(position), text.length());
+    return true;
+}
+
+
+int TextEdit::replaceAll(const QString & search, const QString & replacement, Qt::CaseSensitivity cs)
+{
+    if (search.isEmpty()) {
+        return 0;
+    }
+
+    _searchEngine.setPattern(search, cs);
+    const QString& content = searchSnapshot();
+    const ushort* data = content.utf16();
+
+    QVector<Edit> edits;
+    qint64 position = _searchEngine.indexIn(data, content.size(), 0);
+    while (position >= 0) {
+        Edit edit = { int(position), search.length(), replacement };
+        edits.append(edit);
+        position = _searchEngine.indexIn(data, content.size(), position + search.length());
+    }
+
+    applyEdits(edits);
+    return edits.size();
+}
+
+
+void TextEdit::selectRange(int position, int length)
+{
+    QTextCursor cur(document());
+    cur.setPosition(position);
+    cur.setPosition(position + length, QTextCursor::KeepAnchor);
+    setTextCursor(cur);
+}
+
+
+const QString& TextEdit::searchSnapshot()
+{
+    // plain text positions are document positions (a paragraph separator is a '\n')
+    const QVector<int> key = snapshotKey();
+    if (key != _snapshotKey) {
+        _searchSnapshot = toPlainText();
+        _snapshotKey = key;
+    }
+    return _searchSnapshot;
+}
+
+
+QVector<int> TextEdit::snapshotKey() const
+{
+    const QTextDocument* doc = document();
+    return QVector<int>() << doc->revision() << doc->availableUndoSteps()
+                          << doc->availableRedoSteps() << doc->characterCount();
+}
+
+
+void TextEdit::updateSearchSnapshot(int position, int charsRemoved, int charsAdded)
+{
+    // not taken yet, or the highlighter just marking blocks dirty
+    if (_snapshotKey.isEmpty() || _highlighter->isApplyingFormats()) {
+        return;
+    }
+    const QVector<int> key = snapshotKey();
+
+    // lengths can count the final paragraph separator, too: when they
+    // do not add up, the snapshot is taken again when needed
+    const int size = document()->characterCount() - 1;
+    const int removed = qMin(charsRemoved, _searchSnapshot.size() - position);
+    const int added = qMin(charsAdded, size - position);
+    if (removed < 0 || added < 0 || _searchSnapshot.size() - removed + added != size) {
+        _searchSnapshot.clear();
+        _snapshotKey.clear();
+        return;
+    }
+
+    // just the edited range is copied (e.g. Replace Next stays cheap
+    // on a big document), as toPlainText() would convert it
+    QTextCursor cur(document());
+    cur.setPosition(position);
+    cur.setPosition(position + added, QTextCursor::KeepAnchor);
+    QString text = cur.selectedText();
+    QChar* data = text.data();
+    for (int i = 0; i < text.length(); ++i) {
+        const ushort unit = data[i].unicode();
+        if (unit == QChar::ParagraphSeparator || unit == QChar::LineSeparator) {
+            data[i] = QLatin1Char('\n');
+        } else if (unit == QChar::Nbsp) {
+            data[i] = QLatin1Char(' ');
+        }
+    }
+
+    _searchSnapshot.replace(position, removed, text);
+    _snapshotKey = key;
+}
+
+
+void TextEdit::gotoLine(int row)
+{
+    QTextCursor cur = textCursor();
+    cur.setPosition( _lineIndex->lineStart(row) );
+    setTextCursor(cur);
+    centerCursor();
+}
+
+
 void TextEdit::syntaxHighlightForFile(const QString & path)
 {
-    const auto def = _highlightRepo->definitionForFileName(path);
+    _syntaxPath = path;
+
+    // shebangs and modelines are in the first characters
+    const int sniffed = qMin(SyntaxResolver::SniffLength, document()->characterCount() - 1);
+    QTextCursor cursor(document());
+    cursor.setPosition(sniffed, QTextCursor::KeepAnchor);
+    const QString head = cursor.selectedText().replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+
+    KSyntaxHighlighting::Repository* repository = Application::instance()->highlightingRepository();
+    const auto def = Application::instance()->syntaxResolver()->definitionFor(path, head);
+    _suspendedDefinition = KSyntaxHighlighting::Definition();
     if (!def.isValid()) {
         qDebug() << "no valid definitions found :(";
         _language.clear();
         return;
     }
 
-    _highlighter->setDefinition(def);
-
     // consider moving to translatedName()
     _language = def.name();
+
+    // a saved document keeps its highlighting, even if it grew
+    if (!_highlightingForced && !_highlighter->definition().isValid()
+            && document()->characterCount() > _highlightingThreshold) {
+        qDebug() << "document too big, syntax highlighting suspended";
+        _suspendedDefinition = def;
+        return;
+    }
+
+    // no theme is needed before the first definition
+    if (!_highlighter->theme().isValid()) {
+        _highlighter->setTheme( repository->themeForPalette(this->palette()) );
+    }
+    _highlighter->setDefinition(def);
+}
+
+
+void TextEdit::setHighlightingThreshold(qint64 size)
+{
+    _highlightingThreshold = size;
+}
+
+
+void TextEdit::resumeHighlighting()
+{
+    if (!isHighlightingSuspended()) {
+        return;
+    }
+
+    const KSyntaxHighlighting::Definition def = _suspendedDefinition;
+    _suspendedDefinition = KSyntaxHighlighting::Definition();
+    _highlightingForced = true;
+
+    if (!_highlighter->theme().isValid()) {
+        _highlighter->setTheme( Application::instance()->highlightingRepository()->themeForPalette(this->palette()) );
+    }
+    _highlighter->setDefinition(def);
 }
 
 
@@ -221,30 +631,8 @@ void TextEdit::setCurrentLineHighlightingEnabled(bool on)
     if (_highlight == on)
         return;
 
-    _highlight = on;    
-    if (on) {
-        highlightCurrentLine();
-        connect(this, &TextEdit::cursorPositionChanged, this, &TextEdit::highlightCurrentLine);
-        return;
-    }
-
-    // else... hide!!!
-    QList<QTextEdit::ExtraSelection> extraSelections;
-
-    if (!isReadOnly()) {
-        QTextEdit::ExtraSelection selection;
-
-        // FIXME: choose right background color
-        QColor lineColor = QColor(Qt::white).lighter(160);
-        selection.format.setBackground(lineColor);
-        selection.format.setProperty(QTextFormat::FullWidthSelection, true);
-        selection.cursor = textCursor();
-        selection.cursor.clearSelection();
-        extraSelections.append(selection);
-    }
-    setExtraSelections(extraSelections);
-
-    disconnect(this, &TextEdit::cursorPositionChanged, this, &TextEdit::highlightCurrentLine);
+    _highlight = on;
+    updateCurrentLine();
 }
 
 
@@ -256,20 +644,35 @@ bool TextEdit::isCurrentLineHighlightingEnabled()
 
 void TextEdit::lineNumberAreaPaintEvent (QPaintEvent *event)
 {
+    if (_digits.isEmpty() || _digitsFont != font()) {
+        prepareDigits();
+    }
+
+    const QRect damaged = event->rect();
+
     QPainter painter(_lineNumberArea);
-    painter.fillRect(event->rect(), Qt::lightGray);
+    painter.fillRect(damaged, Qt::lightGray);
+    painter.setPen(Qt::black);
+    painter.setFont(_digitsFont);
 
+    const int right = _lineNumberArea->width();
+
+    // the geometry of the first block, then just the heights
     QTextBlock block = firstVisibleBlock();
     int blockNumber = block.blockNumber();
     int top = (int) blockBoundingGeometry(block).translated(contentOffset()).top();
     int bottom = top + (int) blockBoundingRect(block).height();
 
-     while (block.isValid() && top <= event->rect().bottom()) {
-        if (block.isVisible() && bottom >= event->rect().top()) {
-            QString number = QString::number(blockNumber + 1);
-            painter.setPen(Qt::black);
-            painter.drawText(0, top, _lineNumberArea->width(), fontMetrics().height(),
-                             Qt::AlignRight, number);
+    while (block.isValid() && top <= damaged.bottom()) {
+        if (block.isVisible() && bottom >= damaged.top() && top + _digitHeight >= damaged.top()) {
+            // right aligned, from the last digit
+            int number = blockNumber + 1;
+            int x = right;
+            do {
+                x -= _digitWidth;
+                painter.drawStaticText(x, top, _digits.at(number % 10));
+                number /= 10;
+            } while (number > 0);
         }
 
         block = block.next();
@@ -280,6 +683,27 @@ void TextEdit::lineNumberAreaPaintEvent (QPaintEvent *event)
 }
 
 
+void TextEdit::prepareDigits()
+{
+    _digitsFont = font();
+    const QFontMetrics metrics(_digitsFont);
+    _digitHeight = metrics.height();
+    _digitWidth = 0;
+
+    _digits.clear();
+    for (char digit = '0'; digit <= '9'; ++digit) {
+        QStaticText text( QString(QLatin1Char(digit)) );
+        text.setTextFormat(Qt::PlainText);
+        text.setPerformanceHint(QStaticText::AggressiveCaching);
+        text.prepare(QTransform(), _digitsFont);
+        _digits.append(text);
+
+        // one cell per digit: they line up also with proportional digits
+        _digitWidth = qMax(_digitWidth, metrics.horizontalAdvance(QLatin1Char(digit)));
+    }
+}
+
+
 int TextEdit::lineNumberAreaWidth()
 {
     int digits = 2;
@@ -289,11 +713,127 @@ int TextEdit::lineNumberAreaWidth()
         ++digits;
     }
 
-    int space = 3 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits;
+    // the cells the digits are painted in
+    if (_digits.isEmpty() || _digitsFont != font()) {
+        prepareDigits();
+    }
+
+    int space = 3 + _digitWidth * digits;
     return space;
 }
 
 
+void TextEdit::indentSelectedBlocks(bool unindent)
+{
+    const QTextCursor selection = textCursor();
+    const int start = selection.selectionStart();
+    const int end = selection.selectionEnd();
+    const bool fromBlockStart = (document()->findBlock(start).position() == start);
+
+    // a selection ending at the start of a line does not take it
+    QTextBlock block = document()->findBlock(start);
+    const int first = block.blockNumber();
+    QTextBlock lastBlock = document()->findBlock(end);
+    if (lastBlock.blockNumber() > first && lastBlock.position() == end) {
+        lastBlock = lastBlock.previous();
+    }
+    const int last = lastBlock.blockNumber();
+
+    const QString indentation = _tabReplace ? _spaces : QString(QChar(QChar::Tabulation));
+    const int maxSpaces = qMax(1, _spaces.length());
+
+    // just the indentation of every line changes, in place: one undo step,
+    // one relayout and the other blocks keep their formats
+    QTextCursor cur(document());
+    cur.beginEditBlock();
+    for (int i = first; i <= last && block.isValid(); ++i, block = block.next()) {
+        const int position = block.position();
+        if (!unindent) {
+            cur.setPosition(position);
+            cur.insertText(indentation);
+            continue;
+        }
+
+        // a tab, or up to a tab worth of spaces
+        int length = 0;
+        if (document()->characterAt(position) == QChar(QChar::Tabulation)) {
+            length = 1;
+        } else {
+            while (length < maxSpaces && document()->characterAt(position + length) == QChar(QChar::Space)) {
+                ++length;
+            }
+        }
+        if (length > 0) {
+            cur.setPosition(position);
+            cur.setPosition(position + length, QTextCursor::KeepAnchor);
+            cur.removeSelectedText();
+        }
+    }
+    cur.endEditBlock();
+
+    // the selection followed the edits: its first line is still taken whole,
+    // and a selection made bottom up still has its anchor at the bottom
+    QTextCursor moved = textCursor();
+    if (fromBlockStart) {
+        const bool backward = (moved.anchor() > moved.position());
+        const int movedStart = document()->findBlockByNumber(first).position();
+        const int movedEnd = moved.selectionEnd();
+        moved.setPosition(backward ? movedEnd : movedStart);
+        moved.setPosition(backward ? movedStart : movedEnd, QTextCursor::KeepAnchor);
+        setTextCursor(moved);
+    }
+}
+
+
+QString TextEdit::newLineIndentation(int position) const
+{
+    const QTextBlock block = document()->findBlock(position);
+    const int column = position - block.position();
+
+    // the text is read once, and scanned just at the two ends of the cursor column
+    const QString text = block.text();
+    const QChar* chars = text.constData();
+
+    int leading = 0;
+    while (leading < column && (chars[leading] == QLatin1Char(' ') || chars[leading] == QLatin1Char('\t'))) {
+        ++leading;
+    }
+    QString indentation = text.left(leading);
+
+    int last = column - 1;
+    while (last >= leading && chars[last].isSpace()) {
+        --last;
+    }
+    if (last < leading) {
+        return indentation;
+    }
+
+    // the definition tells how the language nests: by indentation (e.g.
+    // Python, YAML) a line ending with a colon opens a level, by folding
+    // regions (e.g. C, JavaScript) an open bracket does
+    KSyntaxHighlighting::Definition def = _highlighter->definition();
+    if (!def.isValid()) {
+        def = _suspendedDefinition;
+    }
+    if (!def.isValid()) {
+        return indentation;
+    }
+
+    const QChar opener = chars[last];
+    bool opens = false;
+    if (def.indentationBasedFoldingEnabled()) {
+        opens = (opener == QLatin1Char(':'));
+    } else if (def.foldingEnabled()) {
+        opens = (opener == QLatin1Char('{') || opener == QLatin1Char('(') || opener == QLatin1Char('['));
+    }
+
+    if (opens) {
+        indentation.append( _tabReplace ? _spaces : QString(QChar(QChar::Tabulation)) );
+    }
+    return indentation;
+}
+
+
 void TextEdit::keyPressEvent(QKeyEvent *event)
 {
     // TAB: (eventually) replace with spaces
@@ -312,26 +852,7 @@ void TextEdit::keyPressEvent(QKeyEvent *event)
             event->accept();
             return;
         } else {
-
-            QTextCursor cur = textCursor();
-            QString selection = cur.selectedText();
-            cur.removeSelectedText();            
-            QStringList rows = selection.split(QChar (QChar::ParagraphSeparator));
-            int start = cur.position();
-            cur.beginEditBlock();
-            for (int i = 0; i < rows.size(); i++) {
-                QString row = rows.at(i);
-                cur.insertText(indentation);
-                cur.insertText (row);
-                if (i != rows.size() - 1) {
-                    cur.insertText( QChar (QChar::ParagraphSeparator) );
-                }
-            }
-            cur.endEditBlock();
-            int end = cur.position();
-            cur.setPosition(start);
-            cur.setPosition(end, QTextCursor::KeepAnchor);
-            setTextCursor(cur);
+            indentSelectedBlocks(false);
             event->accept();
             return;
         }
@@ -343,48 +864,15 @@ void TextEdit::keyPressEvent(QKeyEvent *event)
             return;
         }
 
-        QString indentation = _tabReplace ? _spaces : QString(QChar (QChar::Tabulation));
-
-        QTextCursor cur = textCursor();
-        QString selection = cur.selectedText();
-        cur.removeSelectedText();            
-        QStringList rows = selection.split(QChar (QChar::ParagraphSeparator));
-        int start = cur.position();
-        cur.beginEditBlock();
-        for (int i = 0; i < rows.size(); i++) {
-            QString row = rows.at(i);
-            if (row.startsWith(indentation)) {
-                row.remove(0, indentation.size());
-            }
-            cur.insertText (row);
-            if (i != rows.size() - 1) {
-                cur.insertText( QChar (QChar::ParagraphSeparator) );
-            }
-        }
-        cur.endEditBlock();
-        int end = cur.position();
-        cur.setPosition(start);
-        cur.setPosition(end, QTextCursor::KeepAnchor);
-        setTextCursor(cur);
+        indentSelectedBlocks(true);
         event->accept();
         return;
     }
 
-    // ENTER / RETURN: preserve indentation
+    // ENTER / RETURN: preserve indentation, one more level after an opener
     if (event->key() == Qt::Key_Return || event->key() == Qt::Key_Enter) {
         QTextCursor actual = textCursor();
-        QTextCursor cur = actual;
-        cur.movePosition(QTextCursor::StartOfLine);
-        QString indentation;
-        while (!cur.atBlockEnd()) {
-            cur.movePosition(QTextCursor::NextCharacter, QTextCursor::KeepAnchor);
-            QString sel = cur.selectedText();
-            if (sel != QString(QChar(QChar::Space)) && sel != QString(QChar(QChar::Tabulation)) ) {
-                break;
-            }
-            indentation.append(sel);
-            cur.clearSelection();    // remember to reset anchor
-        }
+        const QString indentation = newLineIndentation(actual.selectionStart());
 
         // go to next line and add indentation
         actual.beginEditBlock();
@@ -414,24 +902,139 @@ void TextEdit::resizeEvent(QResizeEvent *event)
 
 void TextEdit::updateLineNumberAreaWidth(int /*newBlockCount*/)
 {
-    setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+    // a new margin lays out the viewport again: just when it changes
+    const int width = lineNumberAreaWidth();
+    if (viewportMargins().left() != width) {
+        setViewportMargins(width, 0, 0, 0);
+    }
+}
+
+
+void TextEdit::updateCursorSelections()
+{
+    updateCurrentLine();
+    updateBrackets();
 }
 
 
-void TextEdit::highlightCurrentLine()
+void TextEdit::updateCurrentLine()
 {
-    QList<QTextEdit::ExtraSelection> extraSelections;
+    int start = -1;
+    const QTextCursor cursor = textCursor();
+    if (_highlight && !isReadOnly()) {
+        const QTextBlock block = cursor.block();
+        start = block.position();
+
+        // the visual line of the cursor, in a wrapped block
+        const QTextLayout* layout = block.layout();
+        if (layout && layout->lineCount() > 1) {
+            const QTextLine line = layout->lineForTextPosition(cursor.positionInBlock());
+            if (line.isValid()) {
+                start += line.textStart();
+            }
+        }
+    }
 
-    if (!isReadOnly()) {
+    // e.g. moving along the same line
+    if (start == _currentLineStart) {
+        return;
+    }
+    _currentLineStart = start;
+
+    QList<QTextEdit::ExtraSelection> selections;
+    if (start >= 0) {
         QTextEdit::ExtraSelection selection;
         selection.format.setBackground(_highlightLineColor);
         selection.format.setProperty(QTextFormat::FullWidthSelection, true);
-        selection.cursor = textCursor();
-        selection.cursor.clearSelection();
-        extraSelections.append(selection);
+        selection.cursor = QTextCursor(document());
+        selection.cursor.setPosition(start);
+        selections.append(selection);
     }
+    _selectionLayers.setLayer(SelectionLayers::CurrentLine, selections);
+}
+
 
-    setExtraSelections(extraSelections);
+void TextEdit::updateBrackets()
+{
+    static const QString brackets = QStringLiteral("()[]{}");
+
+    const int position = textCursor().position();
+    const int revision = document()->revision();
+    if (position == _bracketPosition && revision == _bracketRevision) {
+        return;
+    }
+    _bracketPosition = position;
+    _bracketRevision = revision;
+
+    // the bracket after the cursor, or the one before it
+    const QTextDocument* doc = document();
+    int at = position;
+    int kind = brackets.indexOf(doc->characterAt(at));
+    if (kind < 0 && at > 0) {
+        --at;
+        kind = brackets.indexOf(doc->characterAt(at));
+    }
+
+    QList<QTextEdit::ExtraSelection> selections;
+    if (kind >= 0 && !isReadOnly()) {
+        const QChar bracket = brackets.at(kind);
+        const QChar partner = brackets.at(kind ^ 1);
+        const int step = (kind % 2 == 0) ? 1 : -1;
+
+        // the text of a block at a time; a new line counts as scanned
+        int match = -1;
+        int depth = 0;
+        int scanned = 0;
+        QTextBlock block = doc->findBlock(at);
+        int column = at - block.position();
+        while (block.isValid()) {
+            const QString text = block.text();
+            for (; column >= 0 && column < text.length() && scanned <= MaxBracketDistance; column += step, ++scanned) {
+                const QChar c = text.at(column);
+                if (c == bracket) {
+                    ++depth;
+                } else if (c == partner && --depth == 0) {
+                    match = block.position() + column;
+                    break;
+                }
+            }
+            if (match >= 0 || scanned > MaxBracketDistance) {
+                break;
+            }
+
+            ++scanned;
+            block = (step > 0) ? block.next() : block.previous();
+            column = (step > 0) ? 0 : block.length() - 2;
+        }
+
+        // unmatched up to the end of the document; too far to tell is
+        // no highlight, rather than a wrong unmatched one
+        if (match >= 0 || !block.isValid()) {
+            QTextEdit::ExtraSelection selection;
+            selection.format.setBackground( match >= 0 ? QColor(Qt::cyan).lighter(160) : QColor(Qt::red).lighter(160) );
+            selection.cursor = QTextCursor(document());
+            for (int p : { at, match }) {
+                if (p >= 0) {
+                    selection.cursor.setPosition(p);
+                    selection.cursor.setPosition(p + 1, QTextCursor::KeepAnchor);
+                    selections.append(selection);
+                }
+            }
+        }
+    }
+    _selectionLayers.setLayer(SelectionLayers::Brackets, selections);
+}
+
+
+void TextEdit::updateOccurrences()
+{
+    _selectionLayers.setLayer(SelectionLayers::Occurrences, _occurrences->selections());
+}
+
+
+void TextEdit::setHighlightedText(const QString & text, Qt::CaseSensitivity cs)
+{
+    _occurrences->setPattern(text, cs);
 }
 
 
@@ -453,10 +1056,10 @@ void TextEdit::updateLineNumberArea(const QRect &rect, int dy)
 void TextEdit::setHighlightLineColor(const QColor& color)
 {
     _highlightLineColor = color;
-    
-    if (_highlight) {
-        highlightCurrentLine();
-    }
+
+    // same line, new color
+    _currentLineStart = -2;
+    updateCurrentLine();
 }
 
 
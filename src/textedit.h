@@ -13,11 +13,23 @@
 
 
 #include <QPlainTextEdit>
+#include <QStaticText>
+#include <QVector>
 
-#include <KSyntaxHighlighting/Repository>
-#include <KSyntaxHighlighting/SyntaxHighlighter>
+#include "filesaver.h"
+#include "incrementalsearch.h"
+#include "searchengine.h"
+#include "selectionlayers.h"
 
+#include <KSyntaxHighlighting/Definition>
+
+class FileLoader;
+class LazyHighlighter;
+class LineIndex;
+class OccurrenceHighlighter;
+class RegexSearch;
 class QTextCodec;
+class QThread;
 
 
 class TextEdit : public QPlainTextEdit
@@ -26,15 +38,65 @@ class TextEdit : public QPlainTextEdit
 
 public:
     explicit TextEdit(QWidget *parent = nullptr);
+    ~TextEdit();
+
+    // replace length characters from position with text
+    struct Edit {
+        int position;
+        int length;
+        QString text;
+    };
 
+    // loading and saving happen in a worker thread: watch the
+    // load/save Progress() and Finished() signals to know how it is going
     void loadFilePath(const QString & path);
     void saveFilePath(const QString & path);
 
+    inline bool isLoading() const { return _loader != nullptr; };
+    inline bool isSaving() const { return _saver != nullptr; };
+
+    // true when the document has been edited after the last save snapshot
+    bool hasChangedSinceSave();
+
     QTextCodec* textCodec();
     void encode(QTextCodec* targetCodec);
 
     inline QString language() const { return _language; };
 
+    // applies edits (sorted by position, not overlapping) in place,
+    // as a single undo step
+    void applyEdits(const QVector<Edit>& edits);
+
+    // selects the next (or previous, with FindBackward) match of text after
+    // (before) the cursor, as QPlainTextEdit::find but over a plain text
+    // snapshot of the document. FindWholeWords is not supported
+    bool findText(const QString & text, QTextDocument::FindFlags flags);
+
+    // selects the first match of text from the start of the selection (the
+    // current match stays while it still matches), narrowing the matches
+    // of the text typed before. restarted is set when it is before the cursor
+    bool findAsYouType(const QString & text, Qt::CaseSensitivity cs, bool* restarted);
+
+    void selectRange(int position, int length);
+
+    // returns the number of replacements
+    int replaceAll(const QString & search, const QString & replacement, Qt::CaseSensitivity cs);
+
+    // regular expression find and replace, matching in a worker thread
+    inline RegexSearch* regexSearch() const { return _regexSearch; };
+
+    // the document as plain text: taken once, then patched by the edits
+    const QString& searchSnapshot();
+
+    // line start positions, always in sync with the document
+    inline LineIndex* lineIndex() const { return _lineIndex; };
+
+    // highlights all the occurrences of text (none if empty)
+    void setHighlightedText(const QString & text, Qt::CaseSensitivity cs);
+
+    // move the cursor at the start of row (0 based), centering it
+    void gotoLine(int row);
+
     // 0 = hide (default), 1 = show, 2 = smart (show with code, hide with plain text)
     void setLineNumbersMode(int mode);
     int lineNumbersMode();
@@ -44,6 +106,15 @@ public:
 
     void setHighlightLineColor(const QColor& color);
     QColor highlightLineColor();
+
+    // characters scanned looking for the bracket matching the one at the
+    // cursor: further away, the bracket is not highlighted at all
+    static const int MaxBracketDistance = 20000;
+
+    // documents with more characters than size are loaded without
+    // syntax highlighting, until resumeHighlighting() is asked for
+    void setHighlightingThreshold(qint64 size);
+    inline bool isHighlightingSuspended() const { return _suspendedDefinition.isValid(); };
     
     // -------------------------------------------------------------------
     void lineNumberAreaPaintEvent (QPaintEvent *event);
@@ -59,35 +130,113 @@ public Q_SLOTS:
     void enableTabReplacement(bool on);
     void updateLineNumbersMode();
 
+    void cancelLoading();
+    void cancelSaving();
+
+    void resumeHighlighting();
+
+Q_SIGNALS:
+    void loadStarted();
+    void loadProgress(int percent);
+    void loadFinished(bool completed);
+
+    void saveProgress(int percent);
+    void saveFinished(bool saved);
+
 protected:
     void keyPressEvent(QKeyEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
 
 private Q_SLOTS:
     void updateLineNumberAreaWidth(int newBlockCount);
-    void highlightCurrentLine();
+    // the current line and the brackets, following the cursor
+    void updateCursorSelections();
+    void updateOccurrences();
     void updateLineNumberArea(const QRect &, int);
+    void updateSearchSnapshot(int position, int charsRemoved, int charsAdded);
 
     // enable syntax highlighting
     void syntaxHighlightForFile(const QString & path);
 
+    void appendLoadedText(const QString & text);
+    void loadingFinished(bool completed);
+
+    void savingFinished(FileSaver::Result result);
+
 private:
+    void stopLoader();
+    void waitForSaver();
+
+    // lays out the gutter digits for the current font
+    void prepareDigits();
+
+    // the key of the current document: the snapshot is up to date when it is the same
+    QVector<int> snapshotKey() const;
+
+    // the indentation of a new line broken at position
+    QString newLineIndentation(int position) const;
+
+    // Tab and Backtab over a selection: (un)indents every line it touches
+    void indentSelectedBlocks(bool unindent);
+
+    // the extra selection layers: each one is set again just when it changes
+    void updateCurrentLine();
+    void updateBrackets();
+
     QWidget* _lineNumberArea;
 
-    KSyntaxHighlighting::SyntaxHighlighter* _highlighter;
-    KSyntaxHighlighting::Repository* _highlightRepo;
+    // the gutter digits, laid out once: line numbers are drawn digit by digit
+    QVector<QStaticText> _digits;
+    QFont _digitsFont;
+    int _digitWidth;
+    int _digitHeight;
+
+    LazyHighlighter* _highlighter;
+    KSyntaxHighlighting::Definition _suspendedDefinition;
+    qint64 _highlightingThreshold;
+    bool _highlightingForced;
 
     QString _language;
+    // the file the syntax definition has been found for
+    QString _syntaxPath;
 
     int _lineNumbersMode;
     
     bool _highlight;
     QColor _highlightLineColor;
+
+    SelectionLayers _selectionLayers;
+    // the start of the highlighted (visual) line, -1 if none
+    int _currentLineStart;
+    // the cursor position and document revision of the bracket matches
+    int _bracketPosition;
+    int _bracketRevision;
     
     bool _tabReplace;
     QString _spaces;
 
     QTextCodec* _textCodec;
+
+    LineIndex* _lineIndex;
+    OccurrenceHighlighter* _occurrences;
+    RegexSearch* _regexSearch;
+
+    SearchEngine _searchEngine;
+    IncrementalSearch _incrementalSearch;
+    QString _searchSnapshot;
+    // revision, undo and redo steps, size of the document snapshot
+    QVector<int> _snapshotKey;
+
+    QThread* _loaderThread;
+    FileLoader* _loader;
+    QString _loadingPath;
+    int _loadGeneration;
+
+    QThread* _saverThread;
+    FileSaver* _saver;
+    QString _savingPath;
+    int _savedRevision;
+    int _saveGeneration;
 };
 
 